@@ -10,11 +10,12 @@ Provides a web interface to manage registered license plates:
 """
 
 from flask import Flask, render_template, request, redirect, url_for, flash, session
-import sqlite3
 import os
 import logging
 import functools
 from datetime import datetime
+from db import Database
+from archive import MovementArchive
 
 # Configure logging
 logging.basicConfig(
@@ -28,6 +29,8 @@ logging.basicConfig(
 
 # Configuration
 db_path = "car_park.db"
+db = Database(db_path)
+log_archive = MovementArchive(db, archive_dir="archive")  # archiving itself runs in the gate
 app = Flask(__name__)
 app.secret_key = os.urandom(24)  # For flash messages and session
 
@@ -35,6 +38,9 @@ app.secret_key = os.urandom(24)  # For flash messages and session
 ADMIN_USERNAME = "admin"
 ADMIN_PASSWORD = "admin"
 
+# Movement log rows per page on /logs
+LOGS_PAGE_SIZE = 100
+
 # Add context processor to provide 'now' to all templates
 @app.context_processor
 def inject_now():
@@ -90,28 +96,30 @@ def logout():
 def dashboard():
     """Main dashboard showing system status"""
     try:
-        conn = sqlite3.connect(db_path)
-        conn.row_factory = sqlite3.Row
-        cursor = conn.cursor()
+        # Get total registered plates (kept up to date by triggers)
+        plate_count = db.fetchone("SELECT count FROM table_counts WHERE name = 'plates'")["count"]
+        
+        # Get cars currently inside (at most the lot capacity, so counting is cheap)
+        parked_count = db.fetchone("SELECT COUNT(*) AS count FROM occupancy")["count"]
         
-        # Get total registered plates
-        cursor.execute("SELECT COUNT(*) as count FROM plates")
-        plate_count = cursor.fetchone()["count"]
+        # Get today's entry/exit counts (UTC days, like the log timestamps)
+        today_counts = {"entry": 0, "exit": 0}
+        for row in db.fetchall("SELECT action, count FROM movement_daily_counts WHERE day = date('now')"):
+            today_counts[row["action"]] = row["count"]
         
         # Get recent entries
-        cursor.execute("""
+        recent_activity = db.fetchall("""
             SELECT plate_number, action, timestamp 
             FROM movement_log 
-            ORDER BY timestamp DESC 
+            ORDER BY timestamp DESC, id DESC 
             LIMIT 5
         """)
-        recent_activity = cursor.fetchall()
-        
-        conn.close()
         
         return render_template(
             "dashboard.html", 
             plate_count=plate_count,
+            parked_count=parked_count,
+            today_counts=today_counts,
             recent_activity=recent_activity
         )
     
@@ -126,14 +134,7 @@ def dashboard():
 def list_plates():
     """List all registered license plates"""
     try:
-        conn = sqlite3.connect(db_path)
-        conn.row_factory = sqlite3.Row
-        cursor = conn.cursor()
-        
-        cursor.execute("SELECT id, plate_number, added_date FROM plates ORDER BY added_date DESC")
-        plates = cursor.fetchall()
-        
-        conn.close()
+        plates = db.fetchall("SELECT id, plate_number, added_date FROM plates ORDER BY added_date DESC")
         
         return render_template("plates.html", plates=plates)
     
@@ -155,25 +156,17 @@ def add_plate():
             return redirect(url_for("add_plate"))
         
         try:
-            conn = sqlite3.connect(db_path)
-            cursor = conn.cursor()
-            
             # Check if plate already exists
-            cursor.execute("SELECT 1 FROM plates WHERE plate_number = ?", (plate_number,))
-            if cursor.fetchone():
+            if db.fetchone("SELECT 1 FROM plates WHERE plate_number = ?", (plate_number,)):
                 flash(f"License plate {plate_number} is already registered", "warning")
-                conn.close()
                 return redirect(url_for("list_plates"))
             
             # Add new plate
-            cursor.execute(
+            db.execute(
                 "INSERT INTO plates (plate_number) VALUES (?)",
                 (plate_number,)
             )
             
-            conn.commit()
-            conn.close()
-            
             flash(f"License plate {plate_number} added successfully", "success")
             return redirect(url_for("list_plates"))
         
@@ -190,26 +183,19 @@ def add_plate():
 def remove_plate(plate_id):
     """Remove a license plate from the system"""
     try:
-        conn = sqlite3.connect(db_path)
-        cursor = conn.cursor()
-        
         # Get the plate number for the confirmation message
-        cursor.execute("SELECT plate_number FROM plates WHERE id = ?", (plate_id,))
-        result = cursor.fetchone()
+        result = db.fetchone("SELECT plate_number FROM plates WHERE id = ?", (plate_id,))
         
         if result:
             plate_number = result[0]
             
             # Delete the plate
-            cursor.execute("DELETE FROM plates WHERE id = ?", (plate_id,))
-            conn.commit()
+            db.execute("DELETE FROM plates WHERE id = ?", (plate_id,))
             
             flash(f"License plate {plate_number} removed successfully", "success")
         else:
             flash("License plate not found", "danger")
         
-        conn.close()
-        
     except Exception as e:
         logging.error(f"Error removing plate: {str(e)}")
         flash("Error removing license plate", "danger")
@@ -217,31 +203,84 @@ def remove_plate(plate_id):
     return redirect(url_for("list_plates"))
 
 
+def parse_date(value):
+    """
+    Validate a YYYY-MM-DD query parameter
+    
+    Returns:
+        str: The date, or None if empty or malformed
+    """
+    try:
+        return datetime.strptime(value, "%Y-%m-%d").strftime("%Y-%m-%d")
+    except (TypeError, ValueError):
+        return None
+
+
+def parse_cursor(value):
+    """
+    Split a 'timestamp|id' page cursor
+    
+    Returns:
+        tuple: (timestamp, id), or None if empty or malformed
+    """
+    try:
+        timestamp, row_id = value.rsplit("|", 1)
+        return timestamp, int(row_id)
+    except (AttributeError, ValueError):
+        return None
+
+
 @app.route("/logs")
 @login_required
 def view_logs():
-    """View vehicle movement logs"""
+    """
+    View vehicle movement logs, newest first
+    
+    Query parameters:
+        plate: Only show this license plate
+        date_from / date_to: Inclusive UTC date range (YYYY-MM-DD)
+        before: Cursor of the last row on the previous page
+    
+    Pages are fetched by keyset (timestamp, id) instead of OFFSET, so every
+    page is a short range scan on the movement_log indexes. Pages older
+    than the hot table continue into the monthly archives.
+    """
+    filters = {
+        "plate": request.args.get("plate", "").strip().upper(),
+        "date_from": parse_date(request.args.get("date_from")),
+        "date_to": parse_date(request.args.get("date_to")),
+    }
+    cursor = parse_cursor(request.args.get("before"))
+    
     try:
-        conn = sqlite3.connect(db_path)
-        conn.row_factory = sqlite3.Row
-        cursor = conn.cursor()
-        
-        cursor.execute("""
-            SELECT id, plate_number, action, timestamp 
-            FROM movement_log 
-            ORDER BY timestamp DESC
-            LIMIT 100
-        """)
-        logs = cursor.fetchall()
+        # One extra row tells whether there is an older page
+        rows = log_archive.query(
+            plate=filters["plate"],
+            date_from=filters["date_from"],
+            date_to=filters["date_to"],
+            before=cursor,
+            limit=LOGS_PAGE_SIZE + 1
+        )
         
-        conn.close()
+        logs = rows[:LOGS_PAGE_SIZE]
+        next_cursor = None
+        if len(rows) > LOGS_PAGE_SIZE:
+            last = logs[-1]
+            next_cursor = f"{last['timestamp']}|{last['id']}"
         
-        return render_template("logs.html", logs=logs)
+        return render_template(
+            "logs.html",
+            logs=logs,
+            filters=filters,
+            next_cursor=next_cursor,
+            paged=cursor is not None,
+            page_size=LOGS_PAGE_SIZE
+        )
     
     except Exception as e:
         logging.error(f"Error viewing logs: {str(e)}")
         flash("Error retrieving log data", "danger")
-        return render_template("logs.html", logs=[])
+        return render_template("logs.html", logs=[], filters=filters, page_size=LOGS_PAGE_SIZE)
 
 
 @app.errorhandler(404)
@@ -259,36 +298,11 @@ def server_error(e):
 
 if __name__ == "__main__":
     # Ensure database exists
-    if not os.path.exists(db_path):
-        try:
-            conn = sqlite3.connect(db_path)
-            cursor = conn.cursor()
-            
-            # Create plates table
-            cursor.execute('''
-            CREATE TABLE IF NOT EXISTS plates (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                plate_number TEXT UNIQUE NOT NULL,
-                added_date TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-            )
-            ''')
-            
-            # Create log table
-            cursor.execute('''
-            CREATE TABLE IF NOT EXISTS movement_log (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                plate_number TEXT NOT NULL,
-                action TEXT NOT NULL,
-                timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-            )
-            ''')
-            
-            conn.commit()
-            conn.close()
-            logging.info("Database initialized")
-            
-        except Exception as e:
-            logging.error(f"Failed to initialize database: {str(e)}")
+    try:
+        db.init_schema()
+        logging.info("Database initialized")
+    except Exception as e:
+        logging.error(f"Failed to initialize database: {str(e)}")
     
     # Run the Flask application
     app.run(host="0.0.0.0", port=5000, debug=True)
\ No newline at end of file
@@ -0,0 +1,291 @@
+"""
+Smart Car Park System - movement_log retention
+
+Rows older than the retention period are moved, a whole calendar month
+at a time, into one SQLite file per month (archive/movement_log_YYYY_MM.db),
+so the hot table in car_park.db stays small. Row ids are kept, so the
+(timestamp, id) keyset used by the logs page stays valid across the hot
+table and the archives, and query() pages through both as one log.
+
+Run it from cron with `python archive.py`, or let the gate call
+MovementArchive.start() to archive once a day.
+"""
+
+import argparse
+import glob
+import logging
+import os
+import re
+import sqlite3
+import threading
+from datetime import datetime, timedelta, timezone
+
+from db import Database, DEFAULT_DB_PATH
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_ARCHIVE_DIR = "archive"
+
+ARCHIVE_SCHEMA = [
+    '''
+    CREATE TABLE IF NOT EXISTS movement_log (
+        id INTEGER PRIMARY KEY,
+        plate_number TEXT NOT NULL,
+        action TEXT NOT NULL,
+        timestamp TIMESTAMP
+    )
+    ''',
+    "CREATE INDEX IF NOT EXISTS idx_movement_log_timestamp ON movement_log (timestamp, id)",
+    "CREATE INDEX IF NOT EXISTS idx_movement_log_plate ON movement_log (plate_number, timestamp, id)",
+]
+
+_MONTH_FILE = re.compile(r"movement_log_(\d{4})_(\d{2})\.db$")
+
+
+def month_bounds(month):
+    """
+    First timestamp of a 'YYYY-MM' month and of the month after it
+
+    Returns:
+        tuple: ('YYYY-MM-01', 'YYYY-MM-01') usable with >= and <
+    """
+    year, mon = (int(part) for part in month.split("-"))
+    year_after, mon_after = (year + 1, 1) if mon == 12 else (year, mon + 1)
+    return f"{year:04d}-{mon:02d}-01", f"{year_after:04d}-{mon_after:02d}-01"
+
+
+def build_log_query(plate=None, date_from=None, date_to=None, before=None, limit=100):
+    """
+    Build the newest-first movement_log page query
+
+    Args:
+        plate: Only rows for this plate number
+        date_from / date_to: Inclusive 'YYYY-MM-DD' range
+        before: (timestamp, id) keyset cursor; only older rows are returned
+        limit: Maximum number of rows
+
+    Returns:
+        tuple: (sql, params)
+    """
+    conditions = []
+    params = []
+    if plate:
+        conditions.append("plate_number = ?")
+        params.append(plate)
+    if date_from:
+        conditions.append("timestamp >= ?")
+        params.append(date_from)
+    if date_to:
+        conditions.append("timestamp < date(?, '+1 day')")
+        params.append(date_to)
+    if before:
+        conditions.append("(timestamp, id) < (?, ?)")
+        params.extend(before)
+    where = f"WHERE {' AND '.join(conditions)}" if conditions else ""
+    sql = f"""
+        SELECT id, plate_number, action, timestamp
+        FROM movement_log
+        {where}
+        ORDER BY timestamp DESC, id DESC
+        LIMIT ?
+    """
+    return sql, params + [limit]
+
+
+class MovementArchive:
+    """
+    Moves old movement_log rows into monthly archive files and reads them back
+
+    Each batch is first copied into the archive (INSERT OR IGNORE on the
+    kept id) and committed, then deleted from the hot table, so a crash in
+    between only leaves rows that the next run deletes without copying
+    them twice. Rows are moved oldest first, so rows still in the hot
+    table are always newer than the archived part of their month.
+    """
+
+    def __init__(self, db, archive_dir=DEFAULT_ARCHIVE_DIR, retention_days=90, batch_size=1000):
+        """
+        Initialize the archive
+
+        Args:
+            db: db.Database instance holding the hot movement_log
+            archive_dir: Directory of the monthly archive files
+            retention_days: Rows are kept at least this long in the hot table
+            batch_size: Rows moved per pair of transactions
+        """
+        self.db = db
+        self.archive_dir = archive_dir
+        self.retention_days = retention_days
+        self.batch_size = batch_size
+        self._stop = threading.Event()
+        self._thread = None
+
+    def archive_path(self, month):
+        """Archive file of a 'YYYY-MM' month"""
+        return os.path.join(self.archive_dir, f"movement_log_{month.replace('-', '_')}.db")
+
+    def months(self):
+        """
+        Months that have an archive file
+
+        Returns:
+            list: 'YYYY-MM' strings, newest first
+        """
+        months = []
+        for path in glob.glob(os.path.join(self.archive_dir, "movement_log_*.db")):
+            match = _MONTH_FILE.search(path)
+            if match:
+                months.append(f"{match.group(1)}-{match.group(2)}")
+        return sorted(months, reverse=True)
+
+    def cutoff(self, now=None):
+        """
+        First timestamp that stays in the hot table
+
+        Only whole months are archived, so this is the start of the month
+        containing now - retention_days.
+        """
+        now = now or datetime.now(timezone.utc)
+        return (now - timedelta(days=self.retention_days)).strftime("%Y-%m-01")
+
+    def archive_old(self, now=None):
+        """
+        Move every row older than the cutoff into its month's archive
+
+        Returns:
+            int: Number of rows moved
+        """
+        cutoff = self.cutoff(now)
+        os.makedirs(self.archive_dir, exist_ok=True)
+        moved = 0
+        with self.db.connection() as conn:
+            months = [row[0] for row in conn.execute(
+                "SELECT DISTINCT substr(timestamp, 1, 7) FROM movement_log WHERE timestamp < ? ORDER BY 1",
+                (cutoff,)
+            )]
+            for month in months:
+                moved += self._archive_month(conn, month)
+        if moved:
+            logger.info(f"Archived {moved} movement_log row(s) older than {cutoff}")
+        return moved
+
+    def _archive_month(self, conn, month):
+        """Move one month of rows in batches, oldest first"""
+        start, end = month_bounds(month)
+        moved = 0
+        conn.execute("ATTACH DATABASE ? AS archive", (self.archive_path(month),))
+        try:
+            with conn:
+                for statement in ARCHIVE_SCHEMA:
+                    conn.execute(statement.replace("EXISTS ", "EXISTS archive.", 1))
+            while True:
+                ids = [row[0] for row in conn.execute(
+                    "SELECT id FROM movement_log WHERE timestamp >= ? AND timestamp < ? "
+                    "ORDER BY timestamp, id LIMIT ?",
+                    (start, end, self.batch_size)
+                )]
+                if not ids:
+                    break
+                marks = ",".join("?" * len(ids))
+                with conn:
+                    conn.execute(
+                        f"INSERT OR IGNORE INTO archive.movement_log (id, plate_number, action, timestamp) "
+                        f"SELECT id, plate_number, action, timestamp FROM main.movement_log WHERE id IN ({marks})",
+                        ids
+                    )
+                with conn:
+                    conn.execute(f"DELETE FROM main.movement_log WHERE id IN ({marks})", ids)
+                moved += len(ids)
+        finally:
+            conn.execute("DETACH DATABASE archive")
+        return moved
+
+    def query(self, plate=None, date_from=None, date_to=None, before=None, limit=100):
+        """
+        One newest-first page of movement_log rows, hot table first, then archives
+
+        Archive files are only opened when the hot table cannot fill the
+        page, i.e. when paging or filtering into archived months.
+
+        Args:
+            plate, date_from, date_to, before, limit: See build_log_query()
+
+        Returns:
+            list: Rows with id, plate_number, action and timestamp
+        """
+        sql, params = build_log_query(plate, date_from, date_to, before, limit)
+        rows = list(self.db.fetchall(sql, params))
+
+        last_month = min(m for m in (before and before[0][:7], date_to and date_to[:7], "9999-99") if m)
+        first_month = date_from[:7] if date_from else ""
+        for month in self.months():
+            if len(rows) >= limit:
+                break
+            if month > last_month:
+                continue
+            if month < first_month:
+                break
+            if rows:
+                before = (rows[-1]["timestamp"], rows[-1]["id"])
+            sql, params = build_log_query(plate, date_from, date_to, before, limit - len(rows))
+            conn = None
+            try:
+                # A missing or corrupt month is skipped, not raised into the web handler
+                conn = sqlite3.connect(f"file:{self.archive_path(month)}?mode=ro", uri=True)
+                conn.row_factory = sqlite3.Row
+                rows.extend(conn.execute(sql, params).fetchall())
+            except sqlite3.Error as e:
+                logger.error(f"Error reading archive {month}: {str(e)}")
+            finally:
+                if conn is not None:
+                    conn.close()
+        return rows
+
+    def start(self, interval=24 * 3600):
+        """Archive now and then every interval seconds on a background thread"""
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._run, args=(interval,), name="movement-archive")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop the background thread"""
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=10)
+            self._thread = None
+
+    def _run(self, interval):
+        """Background loop: archive, then wait for the next round"""
+        while True:
+            try:
+                self.archive_old()
+            except Exception as e:
+                logger.error(f"Error archiving movement_log: {str(e)}")
+            if self._stop.wait(interval):
+                return
+
+
+def main():
+    """Archive old movement_log rows once and exit"""
+    parser = argparse.ArgumentParser(description="Move old movement_log rows into monthly archive files")
+    parser.add_argument("--db", default=DEFAULT_DB_PATH, help="Hot database file")
+    parser.add_argument("--archive-dir", default=DEFAULT_ARCHIVE_DIR, help="Directory of the archive files")
+    parser.add_argument("--retention-days", type=int, default=90, help="Days kept in the hot table")
+    parser.add_argument("--vacuum", action="store_true", help="VACUUM the hot database afterwards to shrink the file")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+    db = Database(args.db)
+    db.init_schema()
+    archive = MovementArchive(db, args.archive_dir, args.retention_days)
+    moved = archive.archive_old()
+    print(f"Moved {moved} row(s) into {args.archive_dir}")
+    if args.vacuum and moved:
+        with db.connection() as conn:
+            conn.execute("VACUUM")
+    db.close()
+
+
+if __name__ == "__main__":
+    main()
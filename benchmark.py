@@ -0,0 +1,363 @@
+#!/usr/bin/python3
+"""
+Smart Car Park System - Micro-benchmarks
+
+Usage:
+    python3 benchmark.py uart [--iterations N]
+    python3 benchmark.py recognition [--images DIR] [--labels CSV] [--json OUT] [--baseline JSON]
+    python3 benchmark.py preprocess [--images DIR] [--iterations N] [--no-detector]
+"""
+
+import argparse
+import csv
+import glob
+import json
+import os
+import platform
+import resource
+import sys
+import time
+
+from parser import normalize_plate
+from protocol import EVENT_DISPLAY, EVENT_SERVO, PACKET_START, PacketEncoder, crc8
+
+
+def crc8_bitwise(data):
+    """Original bit-by-bit CRC8 (polynomial 0x07), kept as the baseline"""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            if crc & 0x80:
+                crc = (crc << 1) ^ 0x07
+            else:
+                crc = crc << 1
+            crc &= 0xFF
+    return crc
+
+
+def encode_baseline(event_id, data):
+    """Original per-call packet construction, kept as the baseline"""
+    packet = bytearray([PACKET_START])
+    packet.append(len(data) + 1)
+    packet.append(event_id)
+    if isinstance(data, (bytes, bytearray)):
+        packet.extend(data)
+    else:
+        packet.extend(data.encode('utf-8'))
+    packet.append(crc8_bitwise(packet[2:]))
+    return bytes(packet)
+
+
+def time_per_call(func, iterations):
+    """Average wall time of func() in microseconds"""
+    start = time.perf_counter()
+    for _ in range(iterations):
+        func()
+    return (time.perf_counter() - start) / iterations * 1e6
+
+
+def bench_uart(args):
+    """Compare CRC8 and packet encoding against the original implementation"""
+    encoder = PacketEncoder()
+    uncached_encoder = PacketEncoder(cache_size=0)  # every call builds the packet
+    payload = b"\x03" + "Invalid Plate".encode('utf-8')
+    servo = bytearray([90])  # as the gate sends it
+
+    # The optimized paths must produce identical bytes
+    assert crc8(payload) == crc8_bitwise(payload)
+    assert encoder.encode(EVENT_DISPLAY, "Welcome") == encode_baseline(EVENT_DISPLAY, "Welcome")
+    assert encoder.encode(EVENT_SERVO, servo) == encode_baseline(EVENT_SERVO, servo)
+    assert uncached_encoder.encode(EVENT_SERVO, servo) == encode_baseline(EVENT_SERVO, servo)
+
+    cases = [
+        ("crc8 bitwise (14 bytes)", lambda: crc8_bitwise(payload)),
+        ("crc8 table (14 bytes)", lambda: crc8(payload)),
+        ("encode baseline \"Welcome\"", lambda: encode_baseline(EVENT_DISPLAY, "Welcome")),
+        ("encode cached \"Welcome\"", lambda: encoder.encode(EVENT_DISPLAY, "Welcome")),
+        ("encode baseline servo angle", lambda: encode_baseline(EVENT_SERVO, servo)),
+        ("encode cached servo angle", lambda: encoder.encode(EVENT_SERVO, servo)),
+        ("encode uncached servo angle", lambda: uncached_encoder.encode(EVENT_SERVO, servo)),
+    ]
+    print(f"{'case':<32} {'us/call':>10}")
+    for name, func in cases:
+        print(f"{name:<32} {time_per_call(func, args.iterations):>10.2f}")
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of a list of numbers (0 for an empty list)"""
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = max(1, int(-(-p * len(ordered) // 100)))  # ceil(p/100 * n)
+    return ordered[rank - 1]
+
+
+def summarize(values):
+    """Latency summary of one stage in milliseconds"""
+    return {
+        "count": len(values),
+        "mean_ms": round(sum(values) / len(values) * 1000, 2) if values else 0.0,
+        "p50_ms": round(percentile(values, 50) * 1000, 2),
+        "p95_ms": round(percentile(values, 95) * 1000, 2),
+        "p99_ms": round(percentile(values, 99) * 1000, 2),
+    }
+
+
+def peak_rss_mb():
+    """Peak resident set size of this process so far"""
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    # Kilobytes on Linux, bytes on macOS
+    return round(peak / (1024 * 1024 if sys.platform == "darwin" else 1024), 1)
+
+
+def load_labels(path):
+    """
+    Read expected plates from a CSV file
+
+    The file has a header row with filename and plate columns; filenames
+    are relative to the image directory.
+
+    Returns:
+        dict: filename -> normalized plate
+    """
+    with open(path, newline="") as f:
+        return {row["filename"]: normalize_plate(row["plate"]) for row in csv.DictReader(f)}
+
+
+def compare_results(result, baseline, max_slowdown, max_accuracy_drop):
+    """
+    Print the differences to a baseline run and list the regressions
+
+    Latency regresses when a stage's p95 grows by more than max_slowdown
+    (a fraction), throughput when it shrinks by more than that, and
+    accuracy when it drops by more than max_accuracy_drop.
+
+    Returns:
+        list: Regression descriptions, empty if none
+    """
+    regressions = []
+    print(f"\n{'vs baseline':<20} {'baseline':>10} {'current':>10} {'change':>8}")
+    for stage, current in result["stages"].items():
+        before = baseline.get("stages", {}).get(stage)
+        if not before or not before["p95_ms"]:
+            continue
+        change = current["p95_ms"] / before["p95_ms"] - 1
+        print(f"{stage + ' p95 ms':<20} {before['p95_ms']:>10.2f} {current['p95_ms']:>10.2f} {change:>+8.1%}")
+        if change > max_slowdown:
+            regressions.append(f"{stage} p95 {before['p95_ms']:.2f} -> {current['p95_ms']:.2f} ms")
+
+    if baseline.get("throughput"):
+        change = result["throughput"] / baseline["throughput"] - 1
+        print(f"{'images/s':<20} {baseline['throughput']:>10.2f} {result['throughput']:>10.2f} {change:>+8.1%}")
+        if change < -max_slowdown:
+            regressions.append(f"throughput {baseline['throughput']:.2f} -> {result['throughput']:.2f} images/s")
+
+    if baseline.get("accuracy") is not None and result["accuracy"] is not None:
+        change = result["accuracy"] - baseline["accuracy"]
+        print(f"{'accuracy':<20} {baseline['accuracy']:>10.1%} {result['accuracy']:>10.1%} {change:>+8.1%}")
+        if change < -max_accuracy_drop:
+            regressions.append(f"accuracy {baseline['accuracy']:.1%} -> {result['accuracy']:.1%}")
+    return regressions
+
+
+def preprocess_baseline(image):
+    """Original OCR preprocessing (bicubic, inverted threshold, 1x1 open, bitwise_not), kept as the baseline"""
+    import cv2
+    import numpy as np
+
+    gray = cv2.cvtColor(image, cv2.COLOR_BGR2GRAY)
+    height, width = gray.shape[:2]
+    target_height = min(height * 2, 400)
+    scale = target_height / height
+    resized = cv2.resize(gray, None, fx=scale, fy=scale, interpolation=cv2.INTER_CUBIC)
+    binary = cv2.adaptiveThreshold(resized, 255, cv2.ADAPTIVE_THRESH_GAUSSIAN_C, cv2.THRESH_BINARY_INV, 11, 2)
+    kernel = np.ones((1, 1), np.uint8)
+    denoised = cv2.morphologyEx(binary, cv2.MORPH_OPEN, kernel)
+    return cv2.bitwise_not(denoised)
+
+
+def bench_preprocess(args):
+    """Compare OCR crop preprocessing against the original implementation on real plates"""
+    import threading
+
+    import cv2
+    from ocr_reader import preprocess_plate
+
+    paths = sorted(p for p in glob.glob(os.path.join(args.images, "*")) if p.lower().endswith((".jpg", ".jpeg", ".png")))
+    frames = [frame for frame in (cv2.imread(path) for path in paths) if frame is not None]
+    if not frames:
+        sys.exit(f"No images found in {args.images}")
+    if args.detector:
+        from detector import LicensePlateDetector
+        detector = LicensePlateDetector(model_path=args.model, backend=args.backend)
+        crops = [crop for crop in (detector.detect_plate(frame) for frame in frames) if crop is not None]
+    else:
+        crops = frames
+    if not crops:
+        sys.exit("No plate detected in the test images; try --no-detector")
+
+    # Output only changes through the interpolation: with bicubic it must match the original exactly
+    cubic = threading.local()
+    mismatches = sum(1 for crop in crops if not (preprocess_plate(crop, cubic, cv2.INTER_CUBIC) == preprocess_baseline(crop)).all())
+    if mismatches:
+        print(f"Bicubic preprocessing differs from the original on {mismatches} of {len(crops)} crop(s)")
+        sys.exit(1)
+    linear = threading.local()
+    differing = sum(int((preprocess_plate(crop, linear, cv2.INTER_LINEAR) != preprocess_baseline(crop)).sum()) for crop in crops)
+    total = sum(preprocess_baseline(crop).size for crop in crops)
+
+    def run_all(func):
+        return lambda: [func(crop) for crop in crops]
+
+    shared = threading.local()
+    cases = [
+        ("baseline", run_all(preprocess_baseline)),
+        ("bicubic, reused buffers", run_all(lambda crop: preprocess_plate(crop, shared, cv2.INTER_CUBIC))),
+        ("bilinear, new buffers", run_all(lambda crop: preprocess_plate(crop, None, cv2.INTER_LINEAR))),
+        ("bilinear, reused buffers", run_all(lambda crop: preprocess_plate(crop, shared, cv2.INTER_LINEAR))),
+    ]
+    print(f"{len(crops)} crop(s) from {args.images}; bilinear output differs from the original in {differing / total:.2%} of pixels")
+    print(f"{'case':<28} {'us/crop':>10}")
+    for name, func in cases:
+        print(f"{name:<28} {time_per_call(func, args.iterations) / len(crops):>10.1f}")
+
+
+def bench_recognition(args):
+    """Run the detector and OCR over an image directory and report speed and accuracy"""
+    import cv2
+    from detector import LicensePlateDetector
+    from model_loader import warm_up
+    from ocr_reader import OCRReader
+
+    paths = sorted(p for p in glob.glob(os.path.join(args.images, "*")) if p.lower().endswith((".jpg", ".jpeg", ".png")))
+    if not paths:
+        sys.exit(f"No images found in {args.images}")
+    labels_path = args.labels or os.path.join(args.images, "labels.csv")
+    labels = load_labels(labels_path) if os.path.exists(labels_path) else {}
+
+    start = time.perf_counter()
+    detector = LicensePlateDetector(model_path=args.model, backend=args.backend, adaptive_roi=args.adaptive_roi)
+    ocr = OCRReader(engine=args.ocr_engine, mode=args.ocr_mode)
+    load_seconds = time.perf_counter() - start
+    if args.warmup:
+        warm_up(detector, ocr, args.images)
+
+    stages = {"decode": [], "detection": [], "ocr": [], "total": []}
+    images = []
+    start = time.perf_counter()
+    for _ in range(args.repeat):
+        for path in paths:
+            t0 = time.perf_counter()
+            frame = cv2.imread(path)
+            t1 = time.perf_counter()
+            crop = detector.detect_plate(frame) if frame is not None else None
+            t2 = time.perf_counter()
+            text, conf = ocr.read_text_with_confidence(crop) if crop is not None else (None, 0.0)
+            t3 = time.perf_counter()
+
+            stages["decode"].append(t1 - t0)
+            stages["detection"].append(t2 - t1)
+            if crop is not None:
+                stages["ocr"].append(t3 - t2)
+            stages["total"].append(t3 - t0)
+            images.append({
+                "file": os.path.basename(path),
+                "detected": crop is not None,
+                "plate": normalize_plate(text) or None,
+                "confidence": round(float(conf), 3),
+                "expected": labels.get(os.path.basename(path)),
+            })
+    elapsed = time.perf_counter() - start
+
+    labelled = [image for image in images if image["expected"] is not None]
+    correct = sum(1 for image in labelled if image["plate"] == image["expected"])
+    result = {
+        "config": {
+            "backend": args.backend,
+            "model": args.model,
+            "ocr_engine": args.ocr_engine,
+            "ocr_mode": args.ocr_mode,
+            "adaptive_roi": args.adaptive_roi,
+            "images": args.images,
+            "repeat": args.repeat,
+            "python": platform.python_version(),
+            "machine": platform.machine(),
+        },
+        "images": len(images),
+        "model_load_seconds": round(load_seconds, 2),
+        "throughput": round(len(images) / elapsed, 2) if elapsed else 0.0,
+        "peak_rss_mb": peak_rss_mb(),
+        "stages": {stage: summarize(values) for stage, values in stages.items()},
+        "detection_rate": round(sum(image["detected"] for image in images) / len(images), 4),
+        "read_rate": round(sum(image["plate"] is not None for image in images) / len(images), 4),
+        "accuracy": round(correct / len(labelled), 4) if labelled else None,
+        "labelled": len(labelled),
+        "ocr_stats": ocr.get_stats(),
+        "per_image": images,
+    }
+
+    print(f"{len(images)} image(s) with {args.backend} + {args.ocr_engine}/{args.ocr_mode}, "
+          f"models loaded in {result['model_load_seconds']:.1f}s")
+    print(f"{'stage':<12} {'mean ms':>9} {'p50 ms':>9} {'p95 ms':>9} {'p99 ms':>9}")
+    for stage, summary in result["stages"].items():
+        print(f"{stage:<12} {summary['mean_ms']:>9.2f} {summary['p50_ms']:>9.2f} "
+              f"{summary['p95_ms']:>9.2f} {summary['p99_ms']:>9.2f}")
+    print(f"throughput {result['throughput']:.2f} images/s, peak RSS {result['peak_rss_mb']:.1f} MB")
+    print(f"detected {result['detection_rate']:.1%}, read {result['read_rate']:.1%}, accuracy "
+          + (f"{result['accuracy']:.1%} of {len(labelled)} labelled" if labelled else f"n/a (no labels in {labels_path})"))
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=2)
+        print(f"Results written to {args.json}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare_results(result, baseline, args.max_slowdown, args.max_accuracy_drop)
+        if regressions:
+            print("Regressions: " + "; ".join(regressions))
+            sys.exit(1)
+        print("No regressions")
+
+
+def main():
+    """Main function"""
+    parser = argparse.ArgumentParser(description="Smart Car Park micro-benchmarks")
+    subparsers = parser.add_subparsers(dest="command", required=True)
+
+    uart = subparsers.add_parser("uart", help="CRC8 and packet encoding cost")
+    uart.add_argument("--iterations", type=int, default=100000)
+    uart.set_defaults(func=bench_uart)
+
+    recognition = subparsers.add_parser("recognition", help="Detector and OCR latency, memory and accuracy over an image directory")
+    recognition.add_argument("--images", default="test_img", help="Directory of test images")
+    recognition.add_argument("--labels", help="CSV with filename,plate columns (default: <images>/labels.csv if present)")
+    recognition.add_argument("--backend", default="torch", choices=["torch", "onnx", "openvino", "ncnn"])
+    recognition.add_argument("--model", help="Detector model path (default: the backend's default)")
+    recognition.add_argument("--ocr-engine", default="det_rec", choices=["det_rec", "rec"])
+    recognition.add_argument("--ocr-mode", default="cascade", choices=["cascade", "double"])
+    recognition.add_argument("--adaptive-roi", action="store_true", help="Learn the plate search region as the gate does")
+    recognition.add_argument("--repeat", type=int, default=3, help="Passes over the image directory")
+    recognition.add_argument("--no-warmup", dest="warmup", action="store_false", help="Include first-inference cost")
+    recognition.add_argument("--json", help="Write machine-readable results here")
+    recognition.add_argument("--baseline", help="Results JSON of an earlier run; exit 1 on a regression")
+    recognition.add_argument("--max-slowdown", type=float, default=0.10, help="Tolerated p95/throughput change (fraction)")
+    recognition.add_argument("--max-accuracy-drop", type=float, default=0.0, help="Tolerated accuracy drop (fraction)")
+    recognition.set_defaults(func=bench_recognition)
+
+    preprocess = subparsers.add_parser("preprocess", help="OCR crop preprocessing cost against the original")
+    preprocess.add_argument("--images", default="test_img", help="Directory of test images")
+    preprocess.add_argument("--iterations", type=int, default=200, help="Passes over the crops per case")
+    preprocess.add_argument("--no-detector", dest="detector", action="store_false", help="Preprocess whole images instead of YOLO crops")
+    preprocess.add_argument("--backend", default="torch", choices=["torch", "onnx", "openvino", "ncnn"])
+    preprocess.add_argument("--model", help="Detector model path (default: the backend's default)")
+    preprocess.set_defaults(func=bench_preprocess)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,216 @@
+import logging
+import queue
+import threading
+
+from metrics import DETECTION_MISSES, STAGE_SECONDS
+
+logger = logging.getLogger(__name__)
+
+
+class PlateVoter:
+    """
+    Confidence-weighted voting over plate readings from several frames
+
+    Readings are grouped by length (the plate format fixes the number of
+    characters) and each character position is voted on separately, so
+    two partially wrong reads can still agree on the right plate.
+    """
+
+    def __init__(self, consensus=0.6, min_support=0.9):
+        """
+        Initialize the voter
+
+        Args:
+            consensus: Fraction of the total vote weight every character of the winner needs
+            min_support: Minimum summed confidence behind every character of the winner
+        """
+        self.consensus = consensus
+        self.min_support = min_support
+        self.readings = []
+        self.total_weight = 0.0
+
+    def add(self, text, confidence):
+        """
+        Add one reading
+
+        Args:
+            text: Cleaned plate text read from one frame
+            confidence: OCR confidence for that text (0-1)
+        """
+        if not text:
+            return
+        weight = max(float(confidence), 0.0)
+        self.readings.append((text, weight))
+        self.total_weight += weight
+
+    def result(self):
+        """
+        Get the current voted plate
+
+        Returns:
+            Tuple (plate_text, support, score) where support is the vote
+            weight behind the weakest character position and score is that
+            weight as a fraction of all vote weight; (None, 0, 0) if empty
+        """
+        if not self.readings or self.total_weight <= 0:
+            return None, 0.0, 0.0
+
+        # Pick the plate length carrying the most weight
+        length_weights = {}
+        for text, weight in self.readings:
+            length_weights[len(text)] = length_weights.get(len(text), 0.0) + weight
+        length = max(length_weights, key=length_weights.get)
+
+        # Vote per character position within that length group
+        position_votes = [{} for _ in range(length)]
+        for text, weight in self.readings:
+            if len(text) != length:
+                continue
+            for i, ch in enumerate(text):
+                position_votes[i][ch] = position_votes[i].get(ch, 0.0) + weight
+
+        plate = []
+        support = length_weights[length]
+        for votes in position_votes:
+            ch = max(votes, key=votes.get)
+            plate.append(ch)
+            support = min(support, votes[ch])
+        return ''.join(plate), support, support / self.total_weight
+
+    def has_consensus(self):
+        """Check whether the voted plate passes the consensus thresholds"""
+        _, support, score = self.result()
+        return support >= self.min_support and score >= self.consensus
+
+
+class BurstRecognizer:
+    """
+    Recognize a plate from a burst of frames with early stopping
+
+    Detection runs in a producer thread while OCR consumes its crops, so
+    the two stages overlap and the later frames share small batched
+    passes. Recognition stops as soon as the voted plate reaches
+    consensus, so a clear first frame costs a single pass, and the
+    producer stops before its next batch.
+    """
+
+    def __init__(self, detector, ocr, consensus=0.6, min_support=0.9, batch_size=2):
+        """
+        Initialize the burst recognizer
+
+        Args:
+            detector: LicensePlateDetector instance
+            ocr: OCRReader instance
+            consensus: Passed to PlateVoter
+            min_support: Passed to PlateVoter
+            batch_size: Frames per batched detection pass after the first frame;
+                an early consensus waits for at most one such pass
+        """
+        self.detector = detector
+        self.ocr = ocr
+        self.consensus = consensus
+        self.min_support = min_support
+        self.batch_size = max(1, batch_size)
+
+    def _detect_frames(self, frames, crops, stop, camera, remember):
+        """
+        Producer: detect plates and push (index, crop, box) triples
+
+        The freshest frame is detected on its own so OCR can start at once;
+        the rest of the burst goes through batched forward passes of
+        batch_size frames while OCR works on the earlier crops. stop is
+        checked before every pass.
+        """
+        try:
+            with STAGE_SECONDS.time(stage="detection"):
+                crop, _, box = self.detector.detect_batch(frames[:1], camera, remember, with_box=True)[0]
+            crops.put((0, crop, box))
+            for start in range(1, len(frames), self.batch_size):
+                if stop.is_set():
+                    break
+                with STAGE_SECONDS.time(stage="detection_batch"):
+                    detections = self.detector.detect_batch(frames[start:start + self.batch_size], camera, remember, with_box=True)
+                for i, (crop, _, box) in enumerate(detections, start=start):
+                    if stop.is_set():
+                        break
+                    crops.put((i, crop, box))
+        finally:
+            crops.put(None)
+
+    def recognize(self, frames, camera=None, remember=True, cancel=None):
+        """
+        Run detection and OCR over a burst of frames
+
+        Args:
+            frames: List of BGR frames, most useful (freshest) first
+            camera: Camera id keying the detector's adaptive ROI history
+            remember: Whether the detected boxes feed that ROI history
+            cancel: Optional threading.Event; once set, recognition stops
+                before the next OCR pass and returns None
+
+        Returns:
+            Dictionary with plate text, support, score, frames used, the
+            best plate crop and its [x1, y1, x2, y2] box in frame pixels, or
+            None if no frame produced a reading
+        """
+        if not frames:
+            return None
+
+        voter = PlateVoter(consensus=self.consensus, min_support=self.min_support)
+        crops = queue.Queue(maxsize=2)
+        stop = threading.Event()
+        producer = threading.Thread(target=self._detect_frames, args=(frames, crops, stop, camera, remember))
+        producer.daemon = True
+        producer.start()
+
+        best_crop = None
+        best_box = None
+        best_conf = -1.0
+        frames_used = 0
+        try:
+            while True:
+                item = crops.get()
+                if item is None:
+                    break
+                if cancel is not None and cancel.is_set():
+                    logger.info("Burst recognition cancelled")
+                    return None
+                index, crop, box = item
+                frames_used = index + 1
+                if crop is None:
+                    DETECTION_MISSES.inc()
+                    continue
+
+                with STAGE_SECONDS.time(stage="ocr"):
+                    text, conf = self.ocr.read_text_with_confidence(crop)
+                if not text:
+                    continue
+                text = text.upper().replace(' ', '')
+                voter.add(text, conf)
+                if conf > best_conf:
+                    best_conf, best_crop, best_box = conf, crop, box
+
+                if voter.has_consensus():
+                    logger.info(f"Burst consensus reached after {frames_used} frame(s)")
+                    break
+        finally:
+            stop.set()
+            # Drain so the producer is never stuck on a full queue; it stops before its next batch
+            while producer.is_alive():
+                try:
+                    crops.get(timeout=0.1)
+                except queue.Empty:
+                    pass
+
+        plate, support, score = voter.result()
+        if plate is None:
+            return None
+        logger.info(f"Burst result {plate} (support {support:.2f}, score {score:.2f}, {len(voter.readings)} reading(s))")
+        return {
+            "plate": plate,
+            "support": support,
+            "score": score,
+            "frames_used": frames_used,
+            "crop": best_crop,
+            "box": [int(v) for v in best_box] if best_box is not None else None
+        }
@@ -0,0 +1,241 @@
+import logging
+import threading
+import time
+
+import cv2
+import numpy as np
+
+logger = logging.getLogger(__name__)
+
+
+class CameraCapture:
+    """
+    Long-lived camera capture service
+
+    Keeps the webcam open so exposure stays settled between vehicles and
+    stores the most recent frames in a ring buffer that is allocated once.
+    Consumers take the freshest frame (or a short burst) without paying for
+    camera start-up on every arrival.
+    """
+
+    def __init__(self, device=0, width=1280, height=720, buffer_size=8):
+        """
+        Initialize the capture service (the camera is opened by start())
+
+        Args:
+            device: OpenCV camera index or device path
+            width: Requested frame width
+            height: Requested frame height
+            buffer_size: Number of recent frames kept in the ring buffer
+        """
+        if buffer_size < 2:
+            raise ValueError("buffer_size must be at least 2")
+        self.device = device
+        self.width = width
+        self.height = height
+        self.buffer_size = buffer_size
+
+        self.cap = None
+        self.running = False
+        self._thread = None
+        self._cond = threading.Condition()
+
+        # Ring buffer, allocated once the real frame shape is known
+        self._frames = None
+        self._timestamps = np.zeros(buffer_size, dtype=np.float64)
+        self._seq = 0  # Number of frames written so far
+
+    def start(self):
+        """
+        Open the camera and start the capture thread
+
+        Returns:
+            True if the camera was opened successfully
+        """
+        if self.running:
+            return True
+        if not self._open():
+            return False
+
+        self.running = True
+        self._thread = threading.Thread(target=self._capture_loop, name="camera-capture")
+        self._thread.daemon = True
+        self._thread.start()
+        logger.info(f"Camera capture running ({self.buffer_size} frame ring buffer)")
+        return True
+
+    def stop(self):
+        """Stop the capture thread and release the camera"""
+        self.running = False
+        if self._thread:
+            self._thread.join(timeout=2)
+            self._thread = None
+        if self.cap is not None:
+            self.cap.release()
+            self.cap = None
+        with self._cond:
+            self._cond.notify_all()
+        logger.info("Camera capture stopped")
+
+    def _open(self):
+        """Open the camera and allocate the ring buffer for its frame shape"""
+        cap = cv2.VideoCapture(self.device)
+        if not cap.isOpened():
+            logger.error(f"Failed to open camera {self.device}")
+            return False
+
+        cap.set(cv2.CAP_PROP_FRAME_WIDTH, self.width)
+        cap.set(cv2.CAP_PROP_FRAME_HEIGHT, self.height)
+        # Keep the driver queue short so the ring buffer holds the real latest frames
+        cap.set(cv2.CAP_PROP_BUFFERSIZE, 1)
+
+        ret, frame = cap.read()
+        if not ret or frame is None:
+            logger.error("Failed to read initial frame from camera")
+            cap.release()
+            return False
+
+        with self._cond:
+            if self._frames is None or self._frames.shape[1:] != frame.shape:
+                self._frames = np.empty((self.buffer_size,) + frame.shape, dtype=frame.dtype)
+                self._seq = 0
+        self.cap = cap
+        logger.info(f"Camera {self.device} opened with frame shape {frame.shape}")
+        return True
+
+    def _capture_loop(self):
+        """Continuously read frames into the ring buffer"""
+        while self.running:
+            # The slot being written is the oldest one, which readers never copy
+            slot = self._seq % self.buffer_size
+            try:
+                ret, frame = self.cap.read(self._frames[slot])
+            except Exception as e:
+                logger.error(f"Error reading camera frame: {str(e)}")
+                ret = False
+
+            if ret and frame is not None and frame is not self._frames[slot]:
+                # Some backends return a new array instead of filling the slot in place
+                slot = self._store(slot, frame)
+
+            if not ret:
+                if not self.running:
+                    break
+                logger.warning("Camera read failed, reopening camera")
+                self.cap.release()
+                time.sleep(1)
+                while self.running and not self._open():
+                    time.sleep(1)
+                continue
+
+            with self._cond:
+                self._timestamps[slot] = time.time()
+                self._seq += 1
+                self._cond.notify_all()
+
+    def _store(self, slot, frame):
+        """
+        Copy a frame the backend allocated itself into the ring buffer
+
+        A new frame size (e.g. after a driver renegotiation) replaces the
+        ring, like _open() does, and the frame becomes its first slot.
+
+        Returns:
+            int: Slot the frame was stored in
+        """
+        if frame.shape == self._frames.shape[1:] and frame.dtype == self._frames.dtype:
+            np.copyto(self._frames[slot], frame)
+            return slot
+        with self._cond:
+            logger.info(f"Camera {self.device} frame shape changed to {frame.shape}")
+            self._frames = np.empty((self.buffer_size,) + frame.shape, dtype=frame.dtype)
+            self._timestamps[:] = 0.0
+            self._seq = 0
+            np.copyto(self._frames[0], frame)
+        return 0
+
+    @property
+    def frame_count(self):
+        """Sequence number of the newest frame (0 when nothing was captured)"""
+        return self._seq
+
+    def latest(self, max_age=1.0):
+        """
+        Get a copy of the freshest frame
+
+        Args:
+            max_age: Maximum age in seconds; older frames are treated as stale
+
+        Returns:
+            BGR frame or None if no fresh frame is available
+        """
+        frames = self.burst(1, max_age=max_age)
+        return frames[0] if frames else None
+
+    def burst(self, count, max_age=1.0):
+        """
+        Get copies of the most recent frames, newest first
+
+        Args:
+            count: Number of frames wanted (at most buffer_size - 1)
+            max_age: Maximum age in seconds of the frames returned
+
+        Returns:
+            List of BGR frames (may be shorter than count)
+        """
+        count = min(count, self.buffer_size - 1)
+        now = time.time()
+        frames = []
+        with self._cond:
+            available = min(self._seq, self.buffer_size - 1)
+            for i in range(min(count, available)):
+                slot = (self._seq - 1 - i) % self.buffer_size
+                if now - self._timestamps[slot] > max_age:
+                    break
+                frames.append(self._frames[slot].copy())
+        return frames
+
+    def thumbnail(self, size, max_age=1.0):
+        """
+        Get a downscaled grey copy of the freshest frame
+
+        The frame is shrunk straight from the ring buffer, so callers
+        polling often (e.g. the motion detector) never copy a full frame.
+
+        Args:
+            size: (width, height) of the thumbnail
+            max_age: Maximum age in seconds; older frames are treated as stale
+
+        Returns:
+            Tuple (seq, greyscale thumbnail), or (seq, None) if no fresh frame
+        """
+        with self._cond:
+            seq = self._seq
+            if seq == 0:
+                return seq, None
+            slot = (seq - 1) % self.buffer_size
+            if time.time() - self._timestamps[slot] > max_age:
+                return seq, None
+            small = cv2.resize(self._frames[slot], size, interpolation=cv2.INTER_AREA)
+        return seq, cv2.cvtColor(small, cv2.COLOR_BGR2GRAY)
+
+    def wait_frame(self, after_seq, timeout=1.0):
+        """
+        Wait for a frame newer than after_seq
+
+        Args:
+            after_seq: Sequence number already consumed by the caller
+            timeout: Maximum time to wait in seconds
+
+        Returns:
+            Tuple (seq, frame) or (after_seq, None) on timeout
+        """
+        deadline = time.time() + timeout
+        with self._cond:
+            while self._seq <= after_seq:
+                remaining = deadline - time.time()
+                if remaining <= 0 or not self.running:
+                    return after_seq, None
+                self._cond.wait(remaining)
+            slot = (self._seq - 1) % self.buffer_size
+            return self._seq, self._frames[slot].copy()
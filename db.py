@@ -0,0 +1,283 @@
+"""
+Smart Car Park System - Shared SQLite access layer
+
+Used by both the gate controller and the web interface:
+- A small pool of long-lived connections instead of connect/close per query
+- WAL journal so dashboard reads and gate writes do not block each other
+- Fixed SQL strings so sqlite3's per-connection statement cache reuses
+  the prepared statements
+"""
+
+import logging
+import queue
+import sqlite3
+import threading
+from contextlib import contextmanager
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_DB_PATH = "car_park.db"
+
+# Applied to every new connection
+PRAGMAS = [
+    "PRAGMA journal_mode=WAL",
+    "PRAGMA synchronous=NORMAL",     # WAL stays consistent; only the last commits may roll back on power loss
+    "PRAGMA mmap_size=67108864",     # 64 MB of the database read through mmap
+    "PRAGMA temp_store=MEMORY",
+    "PRAGMA foreign_keys=ON",
+]
+
+SCHEMA = [
+    '''
+    CREATE TABLE IF NOT EXISTS plates (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        plate_number TEXT UNIQUE NOT NULL,
+        added_date TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    )
+    ''',
+    '''
+    CREATE TABLE IF NOT EXISTS movement_log (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        plate_number TEXT NOT NULL,
+        action TEXT NOT NULL,  -- 'entry' or 'exit'
+        timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+    )
+    ''',
+    # Bumped on every change to plates so other processes can notice edits cheaply
+    '''
+    CREATE TABLE IF NOT EXISTS plates_version (
+        id INTEGER PRIMARY KEY CHECK (id = 1),
+        version INTEGER NOT NULL
+    )
+    ''',
+    "INSERT OR IGNORE INTO plates_version (id, version) VALUES (1, 0)",
+    '''
+    CREATE TRIGGER IF NOT EXISTS plates_version_insert AFTER INSERT ON plates
+    BEGIN UPDATE plates_version SET version = version + 1 WHERE id = 1; END
+    ''',
+    '''
+    CREATE TRIGGER IF NOT EXISTS plates_version_update AFTER UPDATE ON plates
+    BEGIN UPDATE plates_version SET version = version + 1 WHERE id = 1; END
+    ''',
+    '''
+    CREATE TRIGGER IF NOT EXISTS plates_version_delete AFTER DELETE ON plates
+    BEGIN UPDATE plates_version SET version = version + 1 WHERE id = 1; END
+    ''',
+]
+
+# Schema changes applied in order on top of SCHEMA; PRAGMA user_version
+# records how many have run
+MIGRATIONS = [
+    # 1: indexes for the dashboard/logs queries and maintained counters
+    [
+        "CREATE INDEX IF NOT EXISTS idx_movement_log_timestamp ON movement_log (timestamp, id)",
+        "CREATE INDEX IF NOT EXISTS idx_movement_log_plate ON movement_log (plate_number, timestamp, id)",
+        '''
+        CREATE TABLE IF NOT EXISTS movement_daily_counts (
+            day TEXT NOT NULL,     -- UTC date, like CURRENT_TIMESTAMP
+            action TEXT NOT NULL,
+            count INTEGER NOT NULL,
+            PRIMARY KEY (day, action)
+        ) WITHOUT ROWID
+        ''',
+        '''
+        CREATE TABLE IF NOT EXISTS table_counts (
+            name TEXT PRIMARY KEY,
+            count INTEGER NOT NULL
+        ) WITHOUT ROWID
+        ''',
+        '''
+        INSERT OR REPLACE INTO movement_daily_counts (day, action, count)
+        SELECT date(timestamp), action, COUNT(*) FROM movement_log GROUP BY 1, 2
+        ''',
+        "INSERT OR REPLACE INTO table_counts (name, count) SELECT 'plates', COUNT(*) FROM plates",
+        # Counts are history: rows later archived out of movement_log stay counted
+        '''
+        CREATE TRIGGER IF NOT EXISTS movement_log_daily_count AFTER INSERT ON movement_log
+        BEGIN
+            INSERT INTO movement_daily_counts (day, action, count)
+            VALUES (date(NEW.timestamp), NEW.action, 1)
+            ON CONFLICT (day, action) DO UPDATE SET count = count + 1;
+        END
+        ''',
+        '''
+        CREATE TRIGGER IF NOT EXISTS plates_count_insert AFTER INSERT ON plates
+        BEGIN UPDATE table_counts SET count = count + 1 WHERE name = 'plates'; END
+        ''',
+        '''
+        CREATE TRIGGER IF NOT EXISTS plates_count_delete AFTER DELETE ON plates
+        BEGIN UPDATE table_counts SET count = count - 1 WHERE name = 'plates'; END
+        ''',
+    ],
+    # 2: plates currently inside the lot, following entries and exits
+    [
+        '''
+        CREATE TABLE IF NOT EXISTS occupancy (
+            plate_number TEXT PRIMARY KEY,
+            entered_at TIMESTAMP NOT NULL
+        ) WITHOUT ROWID
+        ''',
+        # Plates whose latest movement is an entry
+        '''
+        INSERT OR REPLACE INTO occupancy (plate_number, entered_at)
+        SELECT plate_number, timestamp FROM movement_log AS m
+        WHERE action = 'entry' AND id = (
+            SELECT id FROM movement_log
+            WHERE plate_number = m.plate_number
+            ORDER BY timestamp DESC, id DESC
+            LIMIT 1
+        )
+        ''',
+        '''
+        CREATE TRIGGER IF NOT EXISTS movement_log_occupancy_entry AFTER INSERT ON movement_log
+        WHEN NEW.action = 'entry'
+        BEGIN INSERT OR REPLACE INTO occupancy (plate_number, entered_at) VALUES (NEW.plate_number, NEW.timestamp); END
+        ''',
+        '''
+        CREATE TRIGGER IF NOT EXISTS movement_log_occupancy_exit AFTER INSERT ON movement_log
+        WHEN NEW.action = 'exit'
+        BEGIN DELETE FROM occupancy WHERE plate_number = NEW.plate_number; END
+        ''',
+    ],
+    # 3: change counter for occupancy, so gates in other processes see each other's moves
+    [
+        '''
+        CREATE TABLE IF NOT EXISTS occupancy_version (
+            id INTEGER PRIMARY KEY CHECK (id = 1),
+            version INTEGER NOT NULL
+        )
+        ''',
+        "INSERT OR IGNORE INTO occupancy_version (id, version) VALUES (1, 0)",
+        '''
+        CREATE TRIGGER IF NOT EXISTS occupancy_version_insert AFTER INSERT ON occupancy
+        BEGIN UPDATE occupancy_version SET version = version + 1 WHERE id = 1; END
+        ''',
+        '''
+        CREATE TRIGGER IF NOT EXISTS occupancy_version_delete AFTER DELETE ON occupancy
+        BEGIN UPDATE occupancy_version SET version = version + 1 WHERE id = 1; END
+        ''',
+    ],
+]
+
+
+class Database:
+    """
+    Pool of long-lived SQLite connections
+
+    Connections are created on demand up to pool_size and handed to one
+    thread at a time, so the same object can be shared by gate worker
+    threads and Flask request threads.
+    """
+
+    def __init__(self, path=DEFAULT_DB_PATH, pool_size=4, timeout=5.0, cached_statements=64):
+        """
+        Initialize the pool (connections are opened lazily)
+
+        Args:
+            path: SQLite database file
+            pool_size: Maximum number of open connections
+            timeout: Seconds to wait for a lock held by another connection
+            cached_statements: Prepared statements cached per connection
+        """
+        self.path = path
+        self.timeout = timeout
+        self.cached_statements = cached_statements
+        self._pool = queue.LifoQueue()
+        self._slots = threading.Semaphore(pool_size)
+
+    def _connect(self):
+        """Open and configure a new connection"""
+        conn = sqlite3.connect(
+            self.path,
+            timeout=self.timeout,
+            cached_statements=self.cached_statements,
+            check_same_thread=False
+        )
+        conn.row_factory = sqlite3.Row
+        for pragma in PRAGMAS:
+            conn.execute(pragma)
+        return conn
+
+    @contextmanager
+    def connection(self):
+        """
+        Borrow a connection for the duration of a with block
+
+        Yields:
+            sqlite3.Connection
+        """
+        self._slots.acquire()
+        try:
+            conn = self._pool.get_nowait()
+        except queue.Empty:
+            try:
+                conn = self._connect()
+            except Exception:
+                self._slots.release()
+                raise
+
+        try:
+            yield conn
+        except sqlite3.IntegrityError:
+            raise
+        except sqlite3.DatabaseError:
+            # Do not hand a possibly broken connection to the next caller
+            conn.close()
+            conn = None
+            raise
+        finally:
+            if conn is not None:
+                if conn.in_transaction:
+                    conn.rollback()
+                self._pool.put(conn)
+            self._slots.release()
+
+    def fetchone(self, sql, params=()):
+        """Run a query and return its first row (or None)"""
+        with self.connection() as conn:
+            return conn.execute(sql, params).fetchone()
+
+    def fetchall(self, sql, params=()):
+        """Run a query and return all rows"""
+        with self.connection() as conn:
+            return conn.execute(sql, params).fetchall()
+
+    def execute(self, sql, params=()):
+        """
+        Run a single write statement in its own transaction
+
+        Returns:
+            sqlite3.Cursor: Cursor with rowcount/lastrowid set
+        """
+        with self.connection() as conn:
+            with conn:
+                return conn.execute(sql, params)
+
+    def init_schema(self):
+        """Create the tables if they do not exist and apply pending migrations"""
+        with self.connection() as conn:
+            with conn:
+                for statement in SCHEMA:
+                    conn.execute(statement)
+
+            version = conn.execute("PRAGMA user_version").fetchone()[0]
+            for number, statements in enumerate(MIGRATIONS[version:], start=version + 1):
+                # Each migration and its version bump commit together
+                conn.execute("BEGIN IMMEDIATE")
+                try:
+                    for statement in statements:
+                        conn.execute(statement)
+                    conn.execute(f"PRAGMA user_version = {number}")
+                    conn.commit()
+                except Exception:
+                    conn.rollback()
+                    raise
+                logger.info(f"Applied database migration {number}")
+
+    def close(self):
+        """Close every idle connection in the pool"""
+        while True:
+            try:
+                self._pool.get_nowait().close()
+            except queue.Empty:
+                break
@@ -0,0 +1,164 @@
+import logging
+import os
+import queue
+import threading
+from collections import deque
+from datetime import datetime
+
+import cv2
+
+logger = logging.getLogger(__name__)
+
+
+class DebugImageSink:
+    """
+    Background writer for debug images
+
+    submit() only puts the image on a bounded queue, so JPEG encoding and
+    SD-card writes never delay a barrier decision. When the queue is full
+    the image is dropped rather than waited for. A writer thread encodes
+    the images and deletes the oldest files whenever the directory grows
+    past max_bytes.
+
+    Which arrivals are kept is decided by sample():
+    - "all": every every_n-th arrival
+    - "failures": every every_n-th arrival without a plate reading
+    - "off": none (images submitted directly, like the detector's, are still written)
+    """
+
+    MODES = ("all", "failures", "off")
+
+    def __init__(self, directory="debug_images", mode="failures", every_n=1,
+                 max_bytes=200 * 1024 * 1024, max_queue=8, jpeg_quality=85):
+        """
+        Initialize the sink (call start() before submitting)
+
+        Args:
+            directory: Where images are written
+            mode: Sampling mode, see the class docstring
+            every_n: Keep one in every_n sampled arrivals
+            max_bytes: Disk quota for the directory; oldest files are removed first
+            max_queue: Images waiting to be written before new ones are dropped
+            jpeg_quality: JPEG quality (0-100)
+        """
+        if mode not in self.MODES:
+            raise ValueError(f"Unknown debug image mode: {mode}")
+        self.directory = directory
+        self.mode = mode
+        self.every_n = max(1, every_n)
+        self.max_bytes = max_bytes
+        self.jpeg_quality = jpeg_quality
+        self.jobs = queue.Queue(maxsize=max_queue)
+        self.running = False
+        self.written = 0
+        self.dropped = 0
+        self._candidates = 0
+        self._files = deque()  # (path, size), oldest first
+        self._total_bytes = 0
+        self._thread = None
+
+    def start(self):
+        """Scan the existing files against the quota and start the writer thread"""
+        if self.running:
+            return
+        os.makedirs(self.directory, exist_ok=True)
+        files = []
+        for entry in os.scandir(self.directory):
+            if entry.is_file() and entry.name.endswith(".jpg"):
+                stat = entry.stat()
+                files.append((stat.st_mtime, entry.path, stat.st_size))
+        for _, path, size in sorted(files):
+            self._files.append((path, size))
+            self._total_bytes += size
+        self._enforce_quota()
+
+        self.running = True
+        self._thread = threading.Thread(target=self._run, name="debug-images")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Write the queued images and stop the writer thread"""
+        if not self.running:
+            return
+        self.running = False
+        self.jobs.put(None)
+        self._thread.join(timeout=10)
+        self._thread = None
+
+    def sample(self, failed):
+        """
+        Decide whether to keep the images of one arrival
+
+        Args:
+            failed: True if no plate was read
+
+        Returns:
+            bool: True if the arrival's images should be submitted
+        """
+        if not self.running or self.mode == "off":
+            return False
+        if self.mode == "failures" and not failed:
+            return False
+        self._candidates += 1
+        return (self._candidates - 1) % self.every_n == 0
+
+    def submit(self, kind, image, box=None):
+        """
+        Queue an image without blocking
+
+        The image is not copied; callers must not modify it afterwards.
+
+        Args:
+            kind: File name prefix, e.g. "original" or "plate"
+            image: BGR image
+            box: Optional (x1, y1, x2, y2) drawn on a copy before writing
+
+        Returns:
+            bool: True if queued, False if dropped
+        """
+        if not self.running or image is None:
+            return False
+        name = f"{kind}_{datetime.now().strftime('%Y%m%d_%H%M%S_%f')}.jpg"
+        try:
+            self.jobs.put_nowait((name, image, box))
+            return True
+        except queue.Full:
+            self.dropped += 1
+            if self.dropped % 100 == 1:
+                logger.warning(f"Debug image queue full, dropped {self.dropped} image(s) so far")
+            return False
+
+    def _run(self):
+        """Writer loop: encode and write queued images"""
+        while True:
+            job = self.jobs.get()
+            if job is None:
+                return
+            name, image, box = job
+            try:
+                if box is not None:
+                    image = image.copy()
+                    x1, y1, x2, y2 = box
+                    cv2.rectangle(image, (x1, y1), (x2, y2), (0, 255, 0), 2)
+                path = os.path.join(self.directory, name)
+                if not cv2.imwrite(path, image, [cv2.IMWRITE_JPEG_QUALITY, self.jpeg_quality]):
+                    logger.error(f"Failed to write debug image {path}")
+                    continue
+                size = os.path.getsize(path)
+                self._files.append((path, size))
+                self._total_bytes += size
+                self.written += 1
+                self._enforce_quota()
+            except Exception as e:
+                logger.error(f"Error writing debug image: {str(e)}")
+
+    def _enforce_quota(self):
+        """Delete the oldest files until the directory fits in max_bytes"""
+        while self._total_bytes > self.max_bytes and self._files:
+            path, size = self._files.popleft()
+            self._total_bytes -= size
+            try:
+                os.remove(path)
+            except OSError:
+                pass
@@ -1,27 +1,102 @@
-import cv2,torch,numpy as np
-from ultralytics import YOLO
-import logging,time,os
+import cv2,numpy as np
+import logging,time,os,threading
+from collections import deque
 logger=logging.getLogger(__name__)
 os.environ['CUDA_VISIBLE_DEVICES']='-1'
 
+# Default model location for each backend (see export_model.py)
+DEFAULT_MODEL_PATHS={
+    'torch':'best.pt',
+    'onnx':'best_int8.onnx',
+    'openvino':'best_int8_openvino_model',
+    'ncnn':'best_ncnn_model',
+}
+
+def letterbox(image,size=640):
+    # Resize keeping aspect ratio and pad to a size x size RGB float blob (NCHW)
+    h,w=image.shape[:2]
+    r=min(size/h,size/w)
+    new_w,new_h=int(round(w*r)),int(round(h*r))
+    dw,dh=(size-new_w)//2,(size-new_h)//2
+    padded=np.full((size,size,3),114,dtype=np.uint8)
+    padded[dh:dh+new_h,dw:dw+new_w]=cv2.resize(image,(new_w,new_h),interpolation=cv2.INTER_LINEAR)
+    blob=padded[:,:,::-1].transpose(2,0,1)[None].astype(np.float32)/255.0
+    return blob,r,(dw,dh)
+
+def decode_image(image_bytes):
+    # Encoded image (JPEG, PNG, ...) to a BGR ndarray, or None if it cannot be decoded
+    return cv2.imdecode(np.frombuffer(image_bytes,np.uint8),cv2.IMREAD_COLOR)
+
 class LicensePlateDetector:
-    def __init__(self,model_path="best.pt",conf_threshold=0.3):
+    # roi is a static (x1, y1, x2, y2) search region in frame fractions; with
+    # adaptive_roi the region is learned from the last roi_history boxes instead
+    # (once roi_min_boxes are known). Detection runs on the region first and
+    # falls back to the full frame on a miss. Regions run at the smaller roi_imgsz
+    # input size where the backend allows it. The learned boxes are kept per camera
+    # id passed to detect_plate/detect_batch, since each lane sees plates elsewhere;
+    # without a camera id (e.g. uploads to the API) no region is learned or used, and
+    # remember=False detects without adding to that history
+    def __init__(self,model_path=None,conf_threshold=0.3,backend='torch',roi=None,adaptive_roi=False,roi_history=20,roi_min_boxes=3,roi_margin=0.5,roi_imgsz=320,debug_sink=None):
+        if backend not in DEFAULT_MODEL_PATHS:
+            raise ValueError(f"Unknown detector backend: {backend}")
         self.conf_threshold=conf_threshold
+        self.backend=backend
+        self.roi=roi
+        self.adaptive_roi=adaptive_roi
+        self.roi_min_boxes=roi_min_boxes
+        self.roi_margin=roi_margin
+        self.roi_imgsz=roi_imgsz
+        self.debug_sink=debug_sink  # optional debug_sink.DebugImageSink for annotated frames
+        self.roi_history=roi_history
+        self._roi_boxes={}  # camera id -> deque of recent boxes in frame fractions
+        self._roi_lock=threading.Lock()
+        self.roi_stats={'roi_hits':0,'full_frame_fallbacks':0}
+        model_path=model_path or DEFAULT_MODEL_PATHS[backend]
         try:
+            logger.info(f"Initializing {backend} detector with model: {model_path}")
+            if backend=='onnx':
+                self._load_onnx(model_path)
+            else:
+                self._load_ultralytics(model_path)
+            logger.info(f"Detector model loaded successfully ({backend})")
+        except Exception as e:
+            logger.error(f"Failed to load {backend} detector model: {str(e)}")
+            raise
+    
+    def _load_ultralytics(self,model_path):
+        # torch and ultralytics are only imported by the backends that need them
+        from ultralytics import YOLO
+        if self.backend=='torch':
+            import torch
             self.device='cuda' if torch.cuda.is_available() else 'cpu'
-            logger.info(f"Initializing YOLOv8 detector with model: {model_path} on device: {self.device}")
             self.model=YOLO(model_path).to(self.device)
             self.model.fuse()
-            logger.info(f"YOLOv8 model loaded and fused successfully")
-        except Exception as e:
-            logger.error(f"Failed to load YOLOv8 model: {str(e)}")
-            raise
+        else:
+            # Exported OpenVINO/NCNN model directories run through the ultralytics predictor
+            self.device='cpu'
+            self.model=YOLO(model_path,task='detect')
+    
+    def _load_onnx(self,model_path):
+        # ONNX Runtime runs the exported model without importing torch at all
+        import onnxruntime as ort
+        options=ort.SessionOptions()
+        options.graph_optimization_level=ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+        options.intra_op_num_threads=os.cpu_count() or 1
+        self.device='cpu'
+        self.session=ort.InferenceSession(model_path,sess_options=options,providers=['CPUExecutionProvider'])
+        model_input=self.session.get_inputs()[0]
+        self.input_name=model_input.name
+        self.input_dtype=np.float16 if model_input.type=='tensor(float16)' else np.float32
+        self.input_size=model_input.shape[2] if isinstance(model_input.shape[2],int) else 640
+        self.dynamic_batch=not isinstance(model_input.shape[0],int)
+        self.dynamic_size=not isinstance(model_input.shape[2],int)  # export_model.py exports dynamic=True
     
     def detect_and_crop(self,image_bytes):
+        # Callers that already hold a decoded BGR ndarray skip imdecode entirely
+        if isinstance(image_bytes,np.ndarray):
+            return self.detect_plate(image_bytes)
         try:
-            # Convert bytes to numpy array
-            nparr=np.frombuffer(image_bytes,np.uint8)
-            image=cv2.imdecode(nparr,cv2.IMREAD_COLOR)
+            image=decode_image(image_bytes)
             
             if image is None:
                 logger.error("Failed to decode image")
@@ -34,45 +109,178 @@ class LicensePlateDetector:
             logger.error(f"Error in license plate detection: {str(e)}")
             return None
             
-    def detect_plate(self,image):
+    def detect_plate(self,image,camera=None,remember=True):
         try:
             logger.info(f"Running license plate detection on image of shape: {image.shape}")
-            results=self.model(image,conf=self.conf_threshold,iou=0.5,max_det=1,verbose=False)
-            
-            if not results or len(results[0].boxes) == 0:
-                logger.warning("No license plates detected by YOLOv8")
-                return None
-                
-            # Get the first (and assumed best) detection
-            box = results[0].boxes[0]
-            conf = float(box.conf[0])
-            x1, y1, x2, y2 = map(int, box.xyxy[0].tolist())
-            
-            logger.info(f"Detected license plate with confidence {conf:.2f} at coordinates: ({x1},{y1}) to ({x2},{y2})")
+            detection=self._infer_with_roi([image],camera,remember)[0]
             
-            # Add a small margin around the plate
-            h, w = image.shape[:2]
-            margin_y, margin_x = int((y2-y1)*0.05), int((x2-x1)*0.05)
-            y1, y2 = max(0, y1-margin_y), min(h, y2+margin_y)
-            x1, x2 = max(0, x1-margin_x), min(w, x2+margin_x)
-            
-            # Crop the license plate from the image
-            plate_crop = image[y1:y2, x1:x2]
-            
-            if plate_crop.size == 0:
-                logger.warning("Plate crop has zero size")
+            if detection is None:
+                logger.warning("No license plates detected")
                 return None
-                
-            # Save debug images if needed
-            if os.environ.get('DEBUG_IMAGES', 'false').lower() == 'true':
-                os.makedirs("debug_images", exist_ok=True)
-                debug_image = image.copy()
-                cv2.rectangle(debug_image, (x1, y1), (x2, y2), (0, 255, 0), 2)
-            # cv2.imwrite(f"debug_images/plate_crop_{int(time.time()*1000)}.jpg", plate_crop)
             
-            logger.info(f"Cropped plate image size: {plate_crop.shape}")
+            plate_crop,_,_=self._crop_plate(image,*detection)
             return plate_crop
             
         except Exception as e:
             logger.error(f"Error in license plate detection: {str(e)}")
-            return None
\ No newline at end of file
+            return None
+    
+    def warm_up(self,image):
+        # One inference at each input size in use, without touching the adaptive ROI history;
+        # returns the plate crop (or None) so OCR can be warmed up on it
+        detection=self._infer([image])[0]
+        if self.roi is not None or self.adaptive_roi:
+            self._infer([image],imgsz=self.roi_imgsz)
+        if detection is None:
+            return None
+        x1,y1,x2,y2=detection[1]
+        return image[y1:y2,x1:x2]
+    
+    # One forward pass over several frames; returns a (plate_crop, confidence)
+    # tuple per input image, (None, 0.0) for frames without a detection. With
+    # with_box the tuples also carry the (x1, y1, x2, y2) crop box in frame pixels
+    def detect_batch(self,images,camera=None,remember=True,with_box=False):
+        if not images:
+            return []
+        miss=(None,0.0,None) if with_box else (None,0.0)
+        try:
+            logger.info(f"Running batched license plate detection on {len(images)} images")
+            detections=[]
+            for image,detection in zip(images,self._infer_with_roi(list(images),camera,remember)):
+                if detection is None:
+                    detections.append(miss)
+                else:
+                    crop=self._crop_plate(image,*detection)
+                    detections.append(crop if with_box else crop[:2])
+            
+            logger.info(f"Batched detection found plates in {sum(1 for detection in detections if detection[0] is not None)}/{len(images)} images")
+            return detections
+            
+        except Exception as e:
+            logger.error(f"Error in batched license plate detection: {str(e)}")
+            return [miss for _ in images]
+    
+    # Search region in frame pixels, or None to search the full frame
+    def _search_region(self,shape,camera):
+        h,w=shape[:2]
+        region=self.roi
+        if self.adaptive_roi and camera is not None:
+            with self._roi_lock:
+                boxes=list(self._roi_boxes.get(camera,()))
+            if len(boxes)>=self.roi_min_boxes:
+                bx1=min(b[0] for b in boxes);by1=min(b[1] for b in boxes)
+                bx2=max(b[2] for b in boxes);by2=max(b[3] for b in boxes)
+                mx,my=(bx2-bx1)*self.roi_margin,(by2-by1)*self.roi_margin
+                region=(bx1-mx,by1-my,bx2+mx,by2+my)
+        if region is None:
+            return None
+        x1,y1=max(0,int(region[0]*w)),max(0,int(region[1]*h))
+        x2,y2=min(w,int(region[2]*w)),min(h,int(region[3]*h))
+        if x2-x1<32 or y2-y1<32 or (x2-x1)*(y2-y1)>=0.9*w*h:
+            return None
+        return x1,y1,x2,y2
+    
+    def _remember_box(self,shape,xyxy,camera):
+        if self.adaptive_roi and camera is not None:
+            h,w=shape[:2]
+            with self._roi_lock:
+                boxes=self._roi_boxes.get(camera)
+                if boxes is None:
+                    boxes=self._roi_boxes[camera]=deque(maxlen=self.roi_history)
+                boxes.append((xyxy[0]/w,xyxy[1]/h,xyxy[2]/w,xyxy[3]/h))
+    
+    # Like _infer, but tries the search region first; boxes are mapped back to
+    # full-resolution frame pixels so the plate crop keeps its full detail
+    def _infer_with_roi(self,images,camera=None,remember=True):
+        detections=[None]*len(images)
+        pending=list(range(len(images)))
+        regions=[self._search_region(image.shape,camera) for image in images]
+        roi_indices=[i for i in pending if regions[i] is not None]
+        if roi_indices:
+            crops=[images[i][regions[i][1]:regions[i][3],regions[i][0]:regions[i][2]] for i in roi_indices]
+            for i,detection in zip(roi_indices,self._infer(crops,imgsz=self.roi_imgsz)):
+                if detection is not None:
+                    conf,(x1,y1,x2,y2)=detection
+                    ox,oy=regions[i][0],regions[i][1]
+                    detections[i]=(conf,(x1+ox,y1+oy,x2+ox,y2+oy))
+            hits=sum(1 for i in roi_indices if detections[i] is not None)
+            with self._roi_lock:
+                self.roi_stats['roi_hits']+=hits
+                self.roi_stats['full_frame_fallbacks']+=len(roi_indices)-hits
+            pending=[i for i in pending if detections[i] is None]
+            if pending:
+                logger.info(f"No plate in search region for {len(pending)} image(s), retrying full frame")
+        if pending:
+            for i,detection in zip(pending,self._infer([images[i] for i in pending])):
+                detections[i]=detection
+        for image,detection in zip(images,detections):
+            if detection is not None and remember:
+                self._remember_box(image.shape,detection[1],camera)
+        return detections
+    
+    # Best box per image as (confidence, (x1, y1, x2, y2)) in image pixels, or None
+    def _infer(self,images,imgsz=None):
+        if self.backend=='onnx':
+            # A fixed-size ONNX input ignores imgsz; dynamic ones (export_model.py) take it
+            return self._infer_onnx(images,imgsz if self.dynamic_size else None)
+        options={'imgsz':imgsz} if imgsz and self.backend=='torch' else {}
+        results=self.model(images,conf=self.conf_threshold,iou=0.5,max_det=1,verbose=False,**options)
+        detections=[]
+        for result in results:
+            if len(result.boxes)==0:
+                detections.append(None)
+            else:
+                box=result.boxes[0]
+                detections.append((float(box.conf[0]),tuple(map(int,box.xyxy[0].tolist()))))
+        return detections
+    
+    def _infer_onnx(self,images,imgsz=None):
+        prepared=[letterbox(image,imgsz or self.input_size) for image in images]
+        if self.dynamic_batch and len(prepared)>1:
+            blob=np.concatenate([p[0] for p in prepared]).astype(self.input_dtype)
+            outputs=self.session.run(None,{self.input_name:blob})[0]
+        else:
+            outputs=np.concatenate([self.session.run(None,{self.input_name:p[0].astype(self.input_dtype)})[0] for p in prepared])
+        detections=[]
+        for image,(_,r,(dw,dh)),preds in zip(images,prepared,outputs):
+            # YOLOv8 head output is (4 + classes, anchors); max_det=1 only needs the top anchor
+            preds=preds.astype(np.float32)
+            scores=preds[4:].max(axis=0)
+            best=int(np.argmax(scores))
+            conf=float(scores[best])
+            if conf<self.conf_threshold:
+                detections.append(None)
+                continue
+            cx,cy,bw,bh=preds[:4,best]
+            h,w=image.shape[:2]
+            x1=int(np.clip((cx-bw/2-dw)/r,0,w))
+            y1=int(np.clip((cy-bh/2-dh)/r,0,h))
+            x2=int(np.clip((cx+bw/2-dw)/r,0,w))
+            y2=int(np.clip((cy+bh/2-dh)/r,0,h))
+            detections.append((conf,(x1,y1,x2,y2)))
+        return detections
+    
+    def _crop_plate(self,image,conf,xyxy):
+        x1, y1, x2, y2 = xyxy
+        
+        logger.info(f"Detected license plate with confidence {conf:.2f} at coordinates: ({x1},{y1}) to ({x2},{y2})")
+        
+        # Add a small margin around the plate
+        h, w = image.shape[:2]
+        margin_y, margin_x = int((y2-y1)*0.05), int((x2-x1)*0.05)
+        y1, y2 = max(0, y1-margin_y), min(h, y2+margin_y)
+        x1, x2 = max(0, x1-margin_x), min(w, x2+margin_x)
+        
+        # Crop the license plate from the image
+        plate_crop = image[y1:y2, x1:x2]
+        
+        if plate_crop.size == 0:
+            logger.warning("Plate crop has zero size")
+            return None,0.0,None
+            
+        # Queue the annotated frame; the sink copies and draws off this thread
+        if self.debug_sink is not None:
+            self.debug_sink.submit("detection",image,box=(x1,y1,x2,y2))
+        
+        logger.info(f"Cropped plate image size: {plate_crop.shape}")
+        return plate_crop,conf,(x1,y1,x2,y2)
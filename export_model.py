@@ -0,0 +1,158 @@
+#!/usr/bin/python3
+"""
+Export the YOLOv8 plate detector for the lightweight inference backends
+
+One-time step run on a development machine (or on the Pi itself):
+- onnx: FP32 ONNX export, then static INT8 quantization calibrated on test_img/
+- openvino: INT8 OpenVINO export calibrated on test_img/
+- ncnn: FP16 NCNN export
+
+The outputs land at the default paths in detector.DEFAULT_MODEL_PATHS, so
+LicensePlateDetector(backend=...) picks them up without extra arguments.
+"""
+
+import argparse
+import glob
+import logging
+import os
+import shutil
+import tempfile
+
+import cv2
+
+from detector import DEFAULT_MODEL_PATHS, letterbox
+
+logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+logger = logging.getLogger(__name__)
+
+IMAGE_EXTENSIONS = ("*.jpg", "*.jpeg", "*.png")
+
+
+def calibration_images(image_dir):
+    """List calibration images in a directory"""
+    paths = []
+    for pattern in IMAGE_EXTENSIONS:
+        paths.extend(glob.glob(os.path.join(image_dir, pattern)))
+    return sorted(paths)
+
+
+class LetterboxCalibrationReader:
+    """
+    ONNX Runtime calibration reader feeding letterboxed calibration images
+
+    Uses the same preprocessing as the ONNX detector backend so the
+    quantization ranges match what the model sees at inference time.
+    """
+
+    def __init__(self, input_name, image_paths, size):
+        self.input_name = input_name
+        self.image_paths = list(image_paths)
+        self.size = size
+        self._index = 0
+
+    def get_next(self):
+        while self._index < len(self.image_paths):
+            image = cv2.imread(self.image_paths[self._index])
+            self._index += 1
+            if image is not None:
+                blob, _, _ = letterbox(image, self.size)
+                return {self.input_name: blob}
+        return None
+
+    def rewind(self):
+        self._index = 0
+
+
+def export_onnx(model_path, image_dir, imgsz, output):
+    """Export to ONNX and quantize to INT8 with static calibration"""
+    from ultralytics import YOLO
+    from onnxruntime.quantization import QuantFormat, QuantType, quantize_static
+    from onnxruntime.quantization.shape_inference import quant_pre_process
+
+    fp32_path = YOLO(model_path).export(format="onnx", imgsz=imgsz, dynamic=True, simplify=True)
+    logger.info(f"Exported FP32 ONNX model to {fp32_path}")
+
+    images = calibration_images(image_dir)
+    if not images:
+        raise RuntimeError(f"No calibration images found in {image_dir}")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        prepared_path = os.path.join(tmp, "prepared.onnx")
+        quant_pre_process(fp32_path, prepared_path)
+
+        import onnx
+        input_name = onnx.load(prepared_path).graph.input[0].name
+        # Only the Conv/MatMul weights and activations are quantized. The head's
+        # final Concat joins box coordinates (0-640) and class scores (0-1), which
+        # would lose the scores entirely under one shared uint8 scale.
+        quantize_static(
+            prepared_path,
+            output,
+            LetterboxCalibrationReader(input_name, images, imgsz),
+            op_types_to_quantize=["Conv", "MatMul"],
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QUInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=True
+        )
+    logger.info(f"Wrote INT8 ONNX model calibrated on {len(images)} images to {output}")
+
+
+def export_openvino(model_path, image_dir, imgsz, output):
+    """Export to OpenVINO INT8, calibrated on the images in image_dir"""
+    from ultralytics import YOLO
+
+    image_dir = os.path.abspath(image_dir)
+    if not calibration_images(image_dir):
+        raise RuntimeError(f"No calibration images found in {image_dir}")
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # ultralytics reads calibration data from a dataset yaml
+        data_yaml = os.path.join(tmp, "calibration.yaml")
+        with open(data_yaml, "w") as f:
+            f.write(f"path: {image_dir}\ntrain: .\nval: .\nnames:\n  0: plate\n")
+        exported = YOLO(model_path).export(format="openvino", imgsz=imgsz, int8=True, data=data_yaml)
+
+    move_export(exported, output)
+
+
+def export_ncnn(model_path, image_dir, imgsz, output):
+    """Export to NCNN with FP16 weights"""
+    from ultralytics import YOLO
+
+    exported = YOLO(model_path).export(format="ncnn", imgsz=imgsz, half=True)
+    move_export(exported, output)
+
+
+def move_export(exported, output):
+    """Move an exported model directory to its backend default path"""
+    if os.path.abspath(exported) != os.path.abspath(output):
+        if os.path.exists(output):
+            shutil.rmtree(output)
+        shutil.move(exported, output)
+    logger.info(f"Wrote exported model to {output}")
+
+
+EXPORTERS = {
+    "onnx": export_onnx,
+    "openvino": export_openvino,
+    "ncnn": export_ncnn,
+}
+
+
+def main():
+    """Main function"""
+    parser = argparse.ArgumentParser(description="Export the plate detector for faster backends")
+    parser.add_argument("backend", choices=sorted(EXPORTERS), help="Target backend")
+    parser.add_argument("--model", default=DEFAULT_MODEL_PATHS["torch"], help="Source PyTorch model")
+    parser.add_argument("--images", default="test_img", help="Calibration image directory")
+    parser.add_argument("--imgsz", type=int, default=640, help="Model input size")
+    parser.add_argument("--output", help="Output path (defaults to the backend default path)")
+    args = parser.parse_args()
+
+    output = args.output or DEFAULT_MODEL_PATHS[args.backend]
+    EXPORTERS[args.backend](args.model, args.images, args.imgsz, output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+"""
+OCR-error-tolerant plate matching
+
+Plates are indexed by a canonical key in which every group of look-alike
+characters (0/O/D/Q, 8/B, 5/S, ...) collapses to one symbol, so a reading
+that differs from a registered plate only by such confusions is found
+with a dict lookup. When other edits are allowed too, a BK-tree over the
+canonical keys finds every key within that many plain edits. Candidates
+are ranked by a confusion-weighted edit distance, where swapping
+look-alike characters costs much less than any other edit.
+"""
+
+# Characters the OCR regularly confuses with each other
+CONFUSION_GROUPS = ["0ODQ", "8B", "5S", "1IL", "2Z", "6G", "4A"]
+CONFUSION_COST = 0.3
+
+_CONFUSABLE = set()
+_CANONICAL = {}
+for _group in CONFUSION_GROUPS:
+    for _a in _group:
+        _CANONICAL[ord(_a)] = _group[0]
+        for _b in _group:
+            if _a != _b:
+                _CONFUSABLE.add((_a, _b))
+
+
+def canonical(text):
+    """Collapse every confusion group to a single character"""
+    return text.translate(_CANONICAL)
+
+
+def levenshtein(a, b):
+    """Plain edit distance, using the bit-parallel algorithm of Myers/Hyyro"""
+    if len(a) > len(b):
+        a, b = b, a
+    if not a:
+        return len(b)
+
+    # One bit per position of the shorter string
+    peq = {}
+    for i, ch in enumerate(a):
+        peq[ch] = peq.get(ch, 0) | (1 << i)
+    mask = (1 << len(a)) - 1
+    last = 1 << (len(a) - 1)
+
+    pv, mv, score = mask, 0, len(a)
+    for ch in b:
+        eq = peq.get(ch, 0)
+        xv = eq | mv
+        xh = (((eq & pv) + pv) ^ pv) | eq
+        ph = mv | (~(xh | pv) & mask)
+        mh = pv & xh
+        if ph & last:
+            score += 1
+        elif mh & last:
+            score -= 1
+        ph = ((ph << 1) | 1) & mask
+        mh = (mh << 1) & mask
+        pv = mh | (~(xv | ph) & mask)
+        mv = ph & xv
+    return score
+
+
+def weighted_distance(a, b):
+    """Edit distance where substituting confusable characters costs CONFUSION_COST"""
+    previous = [float(j) for j in range(len(b) + 1)]
+    for i, ca in enumerate(a, 1):
+        current = [float(i)]
+        for j, cb in enumerate(b, 1):
+            if ca == cb:
+                substitute = 0.0
+            elif (ca, cb) in _CONFUSABLE:
+                substitute = CONFUSION_COST
+            else:
+                substitute = 1.0
+            current.append(min(
+                previous[j] + 1.0,
+                current[j - 1] + 1.0,
+                previous[j - 1] + substitute
+            ))
+        previous = current
+    return previous[-1]
+
+
+class BKTree:
+    """
+    Burkhard-Keller tree over strings with the plain edit distance
+
+    The triangle inequality lets a query skip every subtree whose edge
+    distance is outside [d - k, d + k], so only a small part of the tree
+    is visited for small k.
+    """
+
+    def __init__(self, words=()):
+        self._root = None  # (word, {distance: child})
+        self._size = 0
+        for word in words:
+            self.add(word)
+
+    def add(self, word):
+        """Insert a word (duplicates are ignored)"""
+        if self._root is None:
+            self._root = (word, {})
+            self._size = 1
+            return
+        node = self._root
+        while True:
+            distance = levenshtein(word, node[0])
+            if distance == 0:
+                return
+            child = node[1].get(distance)
+            if child is None:
+                node[1][distance] = (word, {})
+                self._size += 1
+                return
+            node = child
+
+    def query(self, word, k):
+        """
+        Find all words within edit distance k
+
+        Returns:
+            list: (word, distance) pairs
+        """
+        if self._root is None:
+            return []
+        matches = []
+        stack = [self._root]
+        while stack:
+            node_word, children = stack.pop()
+            distance = levenshtein(word, node_word)
+            if distance <= k:
+                matches.append((node_word, distance))
+            for edge, child in children.items():
+                if distance - k <= edge <= distance + k:
+                    stack.append(child)
+        return matches
+
+    def __len__(self):
+        return self._size
+
+
+class FuzzyPlateMatcher:
+    """
+    Best registered plate for an OCR reading, with a match score
+
+    A candidate is accepted only when its weighted distance is at most
+    max_cost plus 1.0 for each of the max_edits plain edits allowed (a
+    plain edit costs 1.0, more than any max_cost for look-alike swaps),
+    and only when no other plate ties with it, so a misread never opens
+    the barrier for an ambiguous match.
+    """
+
+    def __init__(self, plates=(), max_edits=0, max_cost=0.6):
+        """
+        Build the matcher
+
+        Args:
+            plates: Iterable of registered plate numbers
+            max_edits: Edits other than look-alike swaps searched for (BK-tree k),
+                each adding 1.0 to the accepted cost
+            max_cost: Weighted distance accepted for look-alike swaps
+        """
+        self.max_edits = max_edits
+        self.max_cost = max_cost
+        self._by_key = {}
+        # Removed keys stay in the tree and are skipped at query time
+        self.tree = BKTree() if max_edits > 0 else None
+        for plate in plates:
+            self.add(plate)
+
+    def add(self, plate):
+        """Register a plate"""
+        key = canonical(plate)
+        plates = self._by_key.get(key)
+        if plates is None:
+            self._by_key[key] = {plate}
+            if self.tree is not None:
+                self.tree.add(key)
+        else:
+            plates.add(plate)
+
+    def remove(self, plate):
+        """Unregister a plate"""
+        key = canonical(plate)
+        plates = self._by_key.get(key)
+        if plates is not None:
+            plates.discard(plate)
+            if not plates:
+                del self._by_key[key]
+
+    def best_match(self, text):
+        """
+        Find the registered plate closest to an OCR reading
+
+        Args:
+            text: Cleaned OCR plate text
+
+        Returns:
+            Tuple (plate, score) with score in (0, 1], or (None, 0.0)
+        """
+        if not text:
+            return None, 0.0
+
+        key = canonical(text)
+        if self.tree is not None:
+            keys = [k for k, _ in self.tree.query(key, self.max_edits)]
+        else:
+            keys = [key]
+        candidates = set()
+        for k in keys:
+            candidates.update(self._by_key.get(k, ()))
+
+        ranked = sorted((weighted_distance(text, plate), plate) for plate in candidates)
+        if not ranked or ranked[0][0] > self.max_cost + self.max_edits:
+            return None, 0.0
+        if len(ranked) > 1 and ranked[1][0] == ranked[0][0]:
+            return None, 0.0
+        cost, plate = ranked[0]
+        return plate, 1.0 - cost / max(len(plate), len(text))
@@ -0,0 +1,577 @@
+"""
+Smart Car Park System - shared inference service
+
+One process holds the detector and OCR models, and every other process
+(the gate controller, or several of them) sends it bursts of frames over
+a Unix socket, so the weights are loaded once per Pi instead of once per
+process.
+
+Frames are not sent through the socket. The client keeps a file in
+/dev/shm mapped into memory and writes the frames there. The request only
+carries the file path and each frame's offset, shape and dtype, and the
+server maps the same file and runs the models on ndarray views of it.
+The best plate crop travels back the same way.
+
+Messages are length-prefixed JSON: a 4-byte big-endian length, then
+UTF-8 JSON. Requests:
+    {"op": "ping"}                -> {"ok": true, "ready": bool, "report": {...}}
+    {"op": "recognize", "shm": path, "frames": [{"offset", "shape", "dtype"}],
+     "crop_offset": int, "crop_capacity": int,
+     "consensus": float, "min_support": float, "camera": str or null, "remember": bool}
+                                  -> {"ok": true, "result": {...} or null}
+Errors are answered with {"ok": false, "error": message}.
+
+Callers of the HTTP API that already hold a BGR ndarray can skip JPEG as
+well: pack_raw_frame() builds a body for POST /lpr/raw, and POST /lpr/shm
+takes a frame in a /dev/shm file by reference (see main.py).
+
+main.py hosts the server next to the /lpr API. Run `python inference_server.py`
+to host it on its own.
+"""
+
+import argparse
+import json
+import logging
+import mmap
+import os
+import socket
+import struct
+import threading
+import time
+
+import numpy as np
+
+from burst import BurstRecognizer
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_SOCKET_PATH = os.environ.get("INFERENCE_SOCKET_PATH", "/tmp/lahu_inference.sock")
+MAX_MESSAGE_BYTES = 1 << 20
+
+# Shared frame files: the server only maps files with this prefix in this directory
+DEFAULT_SHM_DIR = os.environ.get("INFERENCE_SHM_DIR", "/dev/shm")
+SHM_PREFIX = "lahu_frames_"
+
+_HEADER = struct.Struct(">I")
+
+# Raw frame: magic, dtype char, number of dimensions, then one uint32 per dimension
+RAW_FRAME_MAGIC = b"LHRF"
+_RAW_FRAME_HEADER = struct.Struct(">4scB")
+RAW_FRAME_DTYPES = ("B",)  # uint8 BGR/greyscale, what the detector takes
+
+
+def send_message(sock, message):
+    """Send one length-prefixed JSON message"""
+    payload = json.dumps(message).encode("utf-8")
+    sock.sendall(_HEADER.pack(len(payload)) + payload)
+
+
+def _recv_exact(sock, size):
+    """Read exactly size bytes, or None if the peer closed the connection"""
+    buffer = bytearray(size)
+    view = memoryview(buffer)
+    received = 0
+    while received < size:
+        count = sock.recv_into(view[received:])
+        if count == 0:
+            return None
+        received += count
+    return buffer
+
+
+def recv_message(sock):
+    """
+    Receive one length-prefixed JSON message
+
+    Returns:
+        The decoded message, or None if the peer closed the connection
+    """
+    header = _recv_exact(sock, _HEADER.size)
+    if header is None:
+        return None
+    (length,) = _HEADER.unpack(header)
+    if length > MAX_MESSAGE_BYTES:
+        raise ValueError(f"Message too large ({length} bytes)")
+    payload = _recv_exact(sock, length)
+    if payload is None:
+        return None
+    return json.loads(payload.decode("utf-8"))
+
+
+def pack_raw_frame(frame):
+    """
+    Encode an ndarray as a raw frame (header + contiguous pixels)
+
+    Args:
+        frame: uint8 ndarray, e.g. a (height, width, 3) BGR frame
+
+    Returns:
+        bytes
+    """
+    if frame.dtype.char not in RAW_FRAME_DTYPES:
+        raise ValueError(f"Unsupported raw frame dtype: {frame.dtype}")
+    header = _RAW_FRAME_HEADER.pack(RAW_FRAME_MAGIC, frame.dtype.char.encode(), frame.ndim)
+    dims = struct.pack(f">{frame.ndim}I", *frame.shape)
+    return header + dims + np.ascontiguousarray(frame).tobytes()
+
+
+def unpack_raw_frame(buffer):
+    """
+    Decode a raw frame without copying the pixels
+
+    Args:
+        buffer: bytes-like object from pack_raw_frame()
+
+    Returns:
+        ndarray view of buffer
+
+    Raises:
+        ValueError: If the header is malformed or does not match the size
+    """
+    if len(buffer) < _RAW_FRAME_HEADER.size:
+        raise ValueError("Raw frame too short")
+    magic, dtype, ndim = _RAW_FRAME_HEADER.unpack_from(buffer)
+    dtype = dtype.decode("ascii", "replace")
+    if magic != RAW_FRAME_MAGIC or dtype not in RAW_FRAME_DTYPES or not 2 <= ndim <= 3:
+        raise ValueError("Not a raw frame")
+    offset = _RAW_FRAME_HEADER.size + 4 * ndim
+    if len(buffer) < offset:
+        raise ValueError("Raw frame too short")
+    shape = struct.unpack_from(f">{ndim}I", buffer, _RAW_FRAME_HEADER.size)
+    count = int(np.prod(shape))
+    if len(buffer) - offset != count * np.dtype(dtype).itemsize:
+        raise ValueError(f"Raw frame size does not match shape {shape}")
+    return np.frombuffer(buffer, dtype=dtype, count=count, offset=offset).reshape(shape)
+
+
+def default_factories(ocr_engine="det_rec"):
+    """
+    Model factories for a ModelLoader, configured from the environment
+
+    DETECTOR_BACKEND, DETECTOR_MODEL, DETECTOR_ROI ("x1,y1,x2,y2" frame
+    fractions, unset for none), ADAPTIVE_ROI (default true) and
+    OCR_ENGINE override the defaults. The adaptive ROI is learned per
+    camera id, so gates using these models over the socket get it while
+    API requests, which carry no camera, always search the full frame.
+    The effective settings are logged.
+
+    Args:
+        ocr_engine: OCR engine unless OCR_ENGINE is set (the API keeps
+            det_rec; the standalone server uses the gate's rec)
+
+    Returns:
+        dict: "detector" and "ocr" factories
+    """
+    from detector import LicensePlateDetector
+    from ocr_reader import OCRReader
+
+    model_path = os.environ.get("DETECTOR_MODEL")
+    backend = os.environ.get("DETECTOR_BACKEND", "torch")
+    roi = os.environ.get("DETECTOR_ROI")
+    roi = tuple(float(v) for v in roi.split(",")) if roi else None
+    if roi is not None and len(roi) != 4:
+        raise ValueError(f"DETECTOR_ROI needs four fractions x1,y1,x2,y2, got {roi}")
+    adaptive_roi = os.environ.get("ADAPTIVE_ROI", "true").lower() == "true"
+    engine = os.environ.get("OCR_ENGINE", ocr_engine)
+    logger.info(f"Inference models: detector {backend} ({model_path or 'default model'}), "
+                f"roi {roi}, adaptive_roi {adaptive_roi}, OCR engine {engine}")
+
+    return {
+        "detector": lambda: LicensePlateDetector(
+            model_path=model_path,
+            backend=backend,
+            roi=roi,
+            adaptive_roi=adaptive_roi
+        ),
+        "ocr": lambda: OCRReader(engine=engine),
+    }
+
+
+class FrameMapping:
+    """A client's shared frame file, mapped into this process"""
+
+    def __init__(self, path, writable=True):
+        """
+        Map the file
+
+        Args:
+            path: Shared frame file
+            writable: Map it read-write (crop replies are written back);
+                otherwise read-only, and array() views are read-only too
+        """
+        self.path = path
+        with open(path, "r+b" if writable else "rb") as f:
+            self.size = os.fstat(f.fileno()).st_size
+            self.map = mmap.mmap(f.fileno(), self.size, access=mmap.ACCESS_WRITE if writable else mmap.ACCESS_READ)
+
+    def array(self, offset, shape, dtype):
+        """ndarray view of part of the mapping (no copy)"""
+        dtype = np.dtype(dtype)
+        if not shape or any(int(d) <= 0 for d in shape):
+            raise ValueError(f"Invalid frame shape {shape}")
+        count = int(np.prod(shape))
+        if offset < 0 or offset + count * dtype.itemsize > self.size:
+            raise ValueError("Frame outside the shared memory file")
+        return np.frombuffer(self.map, dtype=dtype, count=count, offset=offset).reshape(shape)
+
+    def close(self):
+        try:
+            self.map.close()
+        except BufferError:
+            # An array view is still alive; the mapping goes when it does
+            pass
+
+
+class InferenceServer:
+    """
+    Unix socket server running burst recognition for other processes
+
+    Each connection is served by its own thread. Inference itself is
+    serialized with inference_lock, which the hosting process also holds
+    around its own use of the models, so the models are never run twice at
+    once and the process never has two competing sets of inference threads.
+    """
+
+    def __init__(self, models, path=DEFAULT_SOCKET_PATH, inference_lock=None, shm_dir=DEFAULT_SHM_DIR):
+        """
+        Initialize the server (start() begins listening)
+
+        Args:
+            models: model_loader.ModelLoader providing "detector" and "ocr"
+            path: Unix socket path
+            inference_lock: Lock shared with other users of the models
+            shm_dir: Only SHM_PREFIX files in this directory are mapped
+        """
+        self.models = models
+        self.path = path
+        self.shm_dir = os.path.realpath(shm_dir)
+        self.inference_lock = inference_lock or threading.Lock()
+        self.running = False
+        self._sock = None
+        self._thread = None
+        self._connections = set()
+        self._connections_lock = threading.Lock()
+
+    def start(self):
+        """Bind the socket and start accepting connections"""
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.bind(self.path)
+        os.chmod(self.path, 0o660)
+        self._sock.listen(8)
+        self.running = True
+        self._thread = threading.Thread(target=self._accept, name="inference-server")
+        self._thread.daemon = True
+        self._thread.start()
+        logger.info(f"Inference server listening on {self.path}")
+
+    def stop(self):
+        """Stop accepting connections, drop the connected clients and remove the socket"""
+        self.running = False
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+        with self._connections_lock:
+            for conn in self._connections:
+                try:
+                    conn.shutdown(socket.SHUT_RDWR)
+                except OSError:
+                    pass
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+
+    def _accept(self):
+        """Accept loop: one thread per client connection"""
+        while self.running:
+            try:
+                conn, _ = self._sock.accept()
+            except OSError:
+                break
+            thread = threading.Thread(target=self._serve, args=(conn,), name="inference-client")
+            thread.daemon = True
+            thread.start()
+
+    def _serve(self, conn):
+        """Connection loop: answer requests until the client disconnects"""
+        mappings = {}
+        with self._connections_lock:
+            self._connections.add(conn)
+        try:
+            while self.running:
+                request = recv_message(conn)
+                if request is None:
+                    break
+                try:
+                    response = self._handle(request, mappings)
+                except Exception as e:
+                    logger.error(f"Error handling inference request: {str(e)}")
+                    response = {"ok": False, "error": str(e)}
+                send_message(conn, response)
+        except (OSError, ValueError) as e:
+            logger.warning(f"Inference client connection closed: {str(e)}")
+        finally:
+            for mapping in mappings.values():
+                mapping.close()
+            with self._connections_lock:
+                self._connections.discard(conn)
+            conn.close()
+
+    def _handle(self, request, mappings):
+        """Dispatch one request"""
+        op = request.get("op")
+        if op == "ping":
+            return {"ok": True, "ready": self.models.is_ready(), "report": self.models.report()}
+        if op == "recognize":
+            if not self.models.is_ready():
+                return {"ok": False, "error": "starting"}
+            return {"ok": True, "result": self._recognize(request, mappings)}
+        return {"ok": False, "error": f"Unknown op: {op}"}
+
+    def _shm_path(self, path):
+        """Resolve a client's shared frame file, refusing anything but SHM_PREFIX files in shm_dir"""
+        path = os.path.realpath(str(path))
+        if (os.path.dirname(path) != self.shm_dir or not os.path.basename(path).startswith(SHM_PREFIX)
+                or not os.path.isfile(path)):
+            raise ValueError(f"Shared memory must be a {SHM_PREFIX}* file in {self.shm_dir}")
+        return path
+
+    def _recognize(self, request, mappings):
+        """Run burst recognition on frames in the client's shared memory"""
+        path = self._shm_path(request["shm"])
+        mapping = mappings.get(path)
+        if mapping is None or mapping.size != os.path.getsize(path):
+            if mapping is not None:
+                mapping.close()
+            mapping = mappings[path] = FrameMapping(path)
+
+        # The crop area must fit the file and follow every frame, or the reply would overwrite them
+        crop_offset = int(request["crop_offset"])
+        crop_capacity = int(request.get("crop_capacity", 0))
+        if crop_offset < 0 or crop_capacity < 0 or crop_offset + crop_capacity > mapping.size:
+            raise ValueError("Crop area outside the shared memory file")
+        frames = []
+        for f in request["frames"]:
+            frame = mapping.array(int(f["offset"]), tuple(f["shape"]), f["dtype"])
+            if int(f["offset"]) + frame.nbytes > crop_offset:
+                raise ValueError("Frame overlaps the crop area")
+            frames.append(frame)
+        recognizer = BurstRecognizer(
+            self.models.get("detector"),
+            self.models.get("ocr"),
+            consensus=request.get("consensus", 0.6),
+            min_support=request.get("min_support", 0.9)
+        )
+        start = time.monotonic()
+        with self.inference_lock:
+            result = recognizer.recognize(frames, camera=request.get("camera"), remember=request.get("remember", True))
+        elapsed = time.monotonic() - start
+        if result is None:
+            return None
+
+        # Hand the crop back through the shared memory as well
+        crop = result.pop("crop")
+        result["crop"] = None
+        if crop is not None and crop.nbytes <= crop_capacity:
+            out = mapping.array(crop_offset, crop.shape, crop.dtype.str)
+            np.copyto(out, crop)
+            result["crop"] = {"shape": list(crop.shape), "dtype": crop.dtype.str}
+        result["seconds"] = round(elapsed, 4)
+        return result
+
+
+class InferenceClient:
+    """
+    Client side of the inference server, used in place of a BurstRecognizer
+
+    Frames are copied once into a file in /dev/shm, which both processes
+    keep mapped. That is the same memcpy the camera's burst() already
+    does, while the detector and OCR models live only in the server. The
+    client reconnects by itself after the server restarts.
+    """
+
+    def __init__(self, path=DEFAULT_SOCKET_PATH, frame_capacity=8 * 1280 * 720 * 3,
+                 crop_capacity=1 << 20, consensus=0.6, min_support=0.9, timeout=10.0,
+                 shm_dir=DEFAULT_SHM_DIR):
+        """
+        Initialize the client (connects on first use)
+
+        Args:
+            path: Server socket path
+            frame_capacity: Bytes reserved for one burst of frames
+            crop_capacity: Bytes reserved for the returned plate crop
+            consensus, min_support: Burst voting settings sent with each request
+            timeout: Seconds to wait for one reply
+            shm_dir: Directory of the shared frame file (the server's shm_dir)
+        """
+        self.path = path
+        self.frame_capacity = frame_capacity
+        self.crop_capacity = crop_capacity
+        self.consensus = consensus
+        self.min_support = min_support
+        self.timeout = timeout
+        self.shm_path = os.path.join(shm_dir, f"{SHM_PREFIX}{os.getpid()}")
+        self._sock = None
+        self._map = None
+        self._lock = threading.Lock()
+
+    def _ensure_map(self):
+        """Create and map the shared frame file"""
+        if self._map is None:
+            size = self.frame_capacity + self.crop_capacity
+            with open(self.shm_path, "w+b") as f:
+                f.truncate(size)
+                self._map = mmap.mmap(f.fileno(), size)
+
+    def _request(self, message):
+        """Send a request and wait for its reply, reconnecting once if needed"""
+        for attempt in (1, 2):
+            try:
+                if self._sock is None:
+                    self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                    self._sock.settimeout(self.timeout)
+                    self._sock.connect(self.path)
+                send_message(self._sock, message)
+                response = recv_message(self._sock)
+                if response is None:
+                    raise ConnectionError("Inference server closed the connection")
+                return response
+            except (OSError, ValueError) as e:
+                self._disconnect()
+                if attempt == 2:
+                    raise ConnectionError(f"Inference server unavailable: {str(e)}") from e
+
+    def _disconnect(self):
+        if self._sock is not None:
+            try:
+                self._sock.close()
+            except OSError:
+                pass
+            self._sock = None
+
+    def ping(self):
+        """
+        Ask the server whether its models are ready
+
+        Returns:
+            bool: True if ready, False if still starting or unreachable
+        """
+        with self._lock:
+            try:
+                return bool(self._request({"op": "ping"}).get("ready"))
+            except ConnectionError:
+                return False
+
+    def wait_ready(self, timeout=300.0, interval=1.0):
+        """
+        Block until the server's models are ready
+
+        Returns:
+            self, so it can be used as a ModelLoader factory
+
+        Raises:
+            TimeoutError: If the server is not ready in time
+        """
+        deadline = time.monotonic() + timeout
+        while not self.ping():
+            if time.monotonic() > deadline:
+                raise TimeoutError(f"Inference server at {self.path} not ready after {timeout:.0f}s")
+            time.sleep(interval)
+        logger.info(f"Connected to inference server at {self.path}")
+        return self
+
+    def recognize(self, frames, camera=None, remember=True, cancel=None):
+        """
+        Run burst recognition in the server
+
+        Args:
+            frames: List of BGR frames, freshest first
+            camera: Camera id keying the detector's adaptive ROI history
+            remember: Whether the detected boxes feed that ROI history
+            cancel: Optional threading.Event; checked before the request is
+                sent, since the server cannot be interrupted once it runs
+
+        Returns:
+            Same dictionary as BurstRecognizer.recognize(), or None
+        """
+        if not frames:
+            return None
+        with self._lock:
+            if cancel is not None and cancel.is_set():
+                return None
+            self._ensure_map()
+            described = []
+            offset = 0
+            view = None
+            for frame in frames:
+                if offset + frame.nbytes > self.frame_capacity:
+                    logger.warning(f"Burst truncated to {len(described)} frame(s) to fit shared memory")
+                    break
+                view = np.frombuffer(self._map, dtype=frame.dtype, count=frame.size, offset=offset)
+                np.copyto(view.reshape(frame.shape), frame)
+                described.append({"offset": offset, "shape": list(frame.shape), "dtype": frame.dtype.str})
+                offset += frame.nbytes
+            del view  # release the export so close() can unmap
+
+            response = self._request({
+                "op": "recognize",
+                "shm": self.shm_path,
+                "frames": described,
+                "crop_offset": self.frame_capacity,
+                "crop_capacity": self.crop_capacity,
+                "consensus": self.consensus,
+                "min_support": self.min_support,
+                "camera": camera,
+                "remember": remember,
+            })
+            if not response.get("ok"):
+                raise RuntimeError(f"Inference server error: {response.get('error')}")
+            result = response.get("result")
+            if result is None:
+                return None
+
+            crop = result.get("crop")
+            if crop is not None:
+                dtype = np.dtype(crop["dtype"])
+                count = int(np.prod(crop["shape"]))
+                result["crop"] = np.frombuffer(
+                    self._map, dtype=dtype, count=count, offset=self.frame_capacity
+                ).reshape(crop["shape"]).copy()
+            return result
+
+    def close(self):
+        """Disconnect and remove the shared frame file"""
+        with self._lock:
+            self._disconnect()
+            if self._map is not None:
+                self._map.close()
+                self._map = None
+            if os.path.exists(self.shm_path):
+                os.unlink(self.shm_path)
+
+
+def main():
+    """Host the models and the inference socket without the HTTP API"""
+    from model_loader import ModelLoader, warm_up
+
+    parser = argparse.ArgumentParser(description="Shared license plate inference server")
+    parser.add_argument("--socket", default=DEFAULT_SOCKET_PATH, help="Unix socket path")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
+    models = ModelLoader(default_factories(ocr_engine="rec"), warmup=lambda loaded: warm_up(loaded["detector"], loaded["ocr"]))
+    models.start()
+    server = InferenceServer(models, args.socket)
+    server.start()
+    try:
+        while not models.failed:
+            time.sleep(1)
+        logger.error(f"Failed to load models ({models.error})")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,163 @@
+import json
+import logging
+import os
+import threading
+from datetime import datetime, timezone
+
+from metrics import STAGE_SECONDS
+
+logger = logging.getLogger(__name__)
+
+INSERT_MOVEMENT = "INSERT INTO movement_log (plate_number, action, timestamp) VALUES (?, ?, ?)"
+FIND_MOVEMENT = "SELECT 1 FROM movement_log WHERE plate_number = ? AND action = ? AND timestamp = ?"
+
+
+class MovementLogWriter:
+    """
+    Background writer for movement_log
+
+    log() only appends the event to a small spool file and returns, so the
+    gate decision never waits on a database commit. A writer thread
+    inserts queued events in one transaction per batch (flushed when
+    batch_size events are waiting or flush_interval has passed) and then
+    trims the spool. Events still in the spool after a crash or restart are
+    replayed on start().
+
+    The spool is flushed to the OS but not fsynced: it survives a process
+    restart, not a power cut in the last moments before a flush.
+    """
+
+    ACTIONS = ("entry", "exit")
+
+    def __init__(self, db, spool_path="movement_log.spool", batch_size=32, flush_interval=1.0):
+        """
+        Initialize the writer (call start() before logging)
+
+        Args:
+            db: db.Database instance
+            spool_path: Append-only file holding events not yet committed
+            batch_size: Events that trigger an immediate flush
+            flush_interval: Maximum seconds an event waits before being written
+        """
+        self.db = db
+        self.spool_path = spool_path
+        self.batch_size = batch_size
+        self.flush_interval = flush_interval
+        self.running = False
+        self._pending = []
+        self._cond = threading.Condition()
+        self._spool = None
+        self._thread = None
+
+    def start(self):
+        """Replay events left in the spool and start the writer thread"""
+        self._replay_spool()
+        self._spool = open(self.spool_path, "a", encoding="utf-8")
+        self.running = True
+        self._thread = threading.Thread(target=self._run, name="movement-log-writer")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Write every pending event and stop the writer thread"""
+        with self._cond:
+            self.running = False
+            self._cond.notify_all()
+        if self._thread:
+            self._thread.join(timeout=10)
+            self._thread = None
+        if self._spool:
+            self._spool.close()
+            self._spool = None
+
+    def log(self, plate_number, action, timestamp=None):
+        """
+        Queue a movement event
+
+        Args:
+            plate_number (str): License plate number
+            action (str): 'entry' or 'exit'
+            timestamp (str): UTC 'YYYY-MM-DD HH:MM:SS', defaults to now
+
+        Returns:
+            bool: True if the event was queued
+        """
+        if action not in self.ACTIONS:
+            raise ValueError(f"Unknown movement action: {action}")
+        if timestamp is None:
+            # Same format and time zone as CURRENT_TIMESTAMP
+            timestamp = datetime.now(timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+        event = (plate_number, action, timestamp)
+
+        with self._cond:
+            if self._spool is None:
+                logger.error("Movement log writer is not running")
+                return False
+            with STAGE_SECONDS.time(stage="spool"):
+                self._spool.write(json.dumps(event) + "\n")
+                self._spool.flush()
+            self._pending.append(event)
+            if len(self._pending) >= self.batch_size:
+                self._cond.notify_all()
+        return True
+
+    def _run(self):
+        """Writer loop: commit pending events in batches"""
+        while True:
+            with self._cond:
+                if self.running and len(self._pending) < self.batch_size:
+                    self._cond.wait(self.flush_interval)
+                batch = self._pending
+                self._pending = []
+                if not batch and not self.running:
+                    return
+
+            if not batch:
+                continue
+
+            try:
+                with STAGE_SECONDS.time(stage="database"):
+                    with self.db.connection() as conn:
+                        with conn:
+                            conn.executemany(INSERT_MOVEMENT, batch)
+                logger.info(f"Wrote {len(batch)} movement event(s)")
+            except Exception as e:
+                logger.error(f"Error writing movement log batch: {str(e)}")
+                with self._cond:
+                    # Keep order and retry on the next flush; the spool still has them
+                    self._pending = batch + self._pending
+                    if not self.running:
+                        return
+                continue
+
+            with self._cond:
+                self._rewrite_spool()
+
+    def _rewrite_spool(self):
+        """Trim the spool to the events not yet committed (caller holds _cond)"""
+        self._spool.seek(0)
+        self._spool.truncate()
+        for event in self._pending:
+            self._spool.write(json.dumps(event) + "\n")
+        self._spool.flush()
+
+    def _replay_spool(self):
+        """Insert events a previous run spooled but did not commit"""
+        if not os.path.exists(self.spool_path):
+            return
+        events = []
+        with open(self.spool_path, encoding="utf-8") as f:
+            for line in f:
+                try:
+                    events.append(tuple(json.loads(line)))
+                except ValueError:
+                    logger.warning(f"Skipping damaged spool line: {line.strip()}")
+        if events:
+            with self.db.connection() as conn:
+                with conn:
+                    # A crash between commit and trim leaves committed events in the spool
+                    unique_events = list(dict.fromkeys(events))
+                    new_events = [e for e in unique_events if conn.execute(FIND_MOVEMENT, e).fetchone() is None]
+                    conn.executemany(INSERT_MOVEMENT, new_events)
+            logger.info(f"Replayed {len(new_events)} of {len(events)} spooled movement event(s)")
+        open(self.spool_path, "w").close()
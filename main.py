@@ -1,32 +1,139 @@
-import os,logging
-from fastapi import FastAPI,File,UploadFile,HTTPException
-from fastapi.responses import JSONResponse
+import os,logging,threading,asyncio
+from fastapi import FastAPI,File,UploadFile,HTTPException,Request
+from fastapi.responses import JSONResponse,Response
 import uvicorn
-from detector import LicensePlateDetector
-from ocr_reader import OCRReader
+from model_loader import ModelLoader,warm_up
+from inference_server import InferenceServer,FrameMapping,default_factories,unpack_raw_frame,DEFAULT_SOCKET_PATH,SHM_PREFIX
+from scheduler import MicroBatchScheduler,Overloaded
+from detector import decode_image
+from parser import normalize_plate
+from metrics import REGISTRY,CONTENT_TYPE,STAGE_SECONDS,DETECTION_MISSES
 logging.basicConfig(level=logging.INFO,format='%(asctime)s - %(name)s - %(levelname)s - %(message)s')
 logger=logging.getLogger(__name__)
 app=FastAPI(title="License Plate Recognition API",description="API for detecting and recognizing license plates from images",version="1.0.0")
-detector=LicensePlateDetector(model_path="best.pt")
-ocr=OCRReader()
+# Detector and OCR load in parallel after startup; requests get 503 until both are warmed up
+models=ModelLoader(default_factories(),warmup=lambda loaded:warm_up(loaded["detector"],loaded["ocr"]))
+# Gate processes started with INFERENCE_SOCKET share these models over a Unix socket;
+# the lock keeps /lpr and socket requests from running the models at the same time
+inference_lock=threading.Lock()
+inference_server=InferenceServer(models,path=DEFAULT_SOCKET_PATH,inference_lock=inference_lock)
+def recognize_batch(images):
+    # Runs on a scheduler worker, never on the event loop: decode, one batched
+    # detection pass, then OCR per crop; returns the raw plate text (or None) per image
+    detector,ocr=models.get("detector"),models.get("ocr")
+    with STAGE_SECONDS.time(stage="decode"):
+        frames=[decode_image(image) if isinstance(image,(bytes,bytearray)) else image for image in images]
+    valid=[i for i,frame in enumerate(frames) if frame is not None]
+    texts=[None]*len(images)
+    with inference_lock:
+        with STAGE_SECONDS.time(stage="detection_batch"):
+            detections=detector.detect_batch([frames[i] for i in valid])
+        for i,(crop,_) in zip(valid,detections):
+            if crop is None:
+                DETECTION_MISSES.inc()
+                continue
+            with STAGE_SECONDS.time(stage="ocr"):
+                texts[i]=ocr.read_text(crop)
+    return texts
+# Concurrent requests are grouped into batches of up to LPR_MAX_BATCH images, waiting at most
+# LPR_MAX_WAIT_MS for a batch to fill; beyond LPR_MAX_PENDING queued images requests get 429
+scheduler=MicroBatchScheduler(
+    recognize_batch,
+    max_batch=int(os.environ.get("LPR_MAX_BATCH","4")),
+    max_wait=int(os.environ.get("LPR_MAX_WAIT_MS","10"))/1000,
+    max_pending=int(os.environ.get("LPR_MAX_PENDING","16")),
+    name="lpr-batch"
+)
+@app.on_event("startup")
+async def load_models():
+    models.start()
+    scheduler.start()
+    if os.environ.get("INFERENCE_SERVER","true").lower()=="true":
+        inference_server.start()
+@app.on_event("shutdown")
+async def stop_inference_server():
+    inference_server.stop()
+    scheduler.stop()
+@app.get("/health")
+async def health():
+    report=models.report()
+    return JSONResponse(status_code=200 if report["state"]=="ready" else 503,content=report)
+@app.get("/metrics")
+async def metrics():
+    # Prometheus scrape: per-stage latency histograms and error counters of this process
+    return Response(content=REGISTRY.render(),media_type=CONTENT_TYPE)
+# /lpr/shm only maps SHM_PREFIX files from here, read-only, never arbitrary files
+SHM_DIR=os.path.realpath(os.environ.get("LPR_SHM_DIR","/dev/shm"))
+async def recognize_image(image):
+    # image is encoded bytes (decoded on the worker) or a BGR ndarray used as is
+    try:
+        future=scheduler.submit(image)
+    except Overloaded:
+        return JSONResponse(status_code=429,content={"error":"Too many requests, try again shortly"},headers={"Retry-After":"1"})
+    # Queue wait plus the batch this image ran in
+    with STAGE_SECONDS.time(stage="request"):
+        plate_text=await asyncio.wrap_future(future)
+    if not plate_text:
+        return JSONResponse(status_code=200,content={"error":"License plate not detected or unreadable"})
+    plate_text=normalize_plate(plate_text)
+    return {"plate_text":plate_text}
+def check_bgr_frame(frame):
+    if frame.ndim!=3 or frame.shape[2]!=3 or frame.dtype.char!='B':
+        raise ValueError(f"Expected a (height, width, 3) uint8 BGR frame, got {frame.dtype} {frame.shape}")
 @app.post("/lpr")
 async def recognize_license_plate(file:UploadFile=File(...)):
     try:
         if not file.content_type.startswith("image/"):
             raise HTTPException(status_code=400,detail="File is not an image")
+        if not models.is_ready():
+            return JSONResponse(status_code=503,content={"error":"Models are still loading"})
         contents=await file.read()
-        cropped_plate=detector.detect_and_crop(contents)
-        # write the cropped plate to a file for debugging
-        if cropped_plate is None:
-            return JSONResponse(status_code=200,content={"error":"License plate not detected or unreadable"})
-        plate_text=ocr.read_text(cropped_plate)
-        print("plate_text",plate_text)
-        if not plate_text:
-            return JSONResponse(status_code=200,content={"error":"License plate not detected or unreadable"})
-        plate_text=''.join(ch for ch in plate_text if ch.isalnum()).upper()
-        return {"plate_text":plate_text}
+        return await recognize_image(contents)
     except Exception as e:
         logger.error(f"Error processing request: {str(e)}")
         return JSONResponse(status_code=500,content={"error":"Error processing the image"})
+@app.post("/lpr/raw")
+async def recognize_raw_frame(request:Request):
+    # Body is a raw frame from inference_server.pack_raw_frame(): header + BGR pixels, no JPEG
+    try:
+        if not models.is_ready():
+            return JSONResponse(status_code=503,content={"error":"Models are still loading"})
+        body=await request.body()
+        try:
+            frame=unpack_raw_frame(body)
+            check_bgr_frame(frame)
+        except ValueError as e:
+            return JSONResponse(status_code=400,content={"error":str(e)})
+        return await recognize_image(frame)
+    except Exception as e:
+        logger.error(f"Error processing raw frame: {str(e)}")
+        return JSONResponse(status_code=500,content={"error":"Error processing the image"})
+@app.post("/lpr/shm")
+async def recognize_shared_frame(request:Request):
+    # Body is {"path": SHM_PREFIX file in SHM_DIR, "offset": int, "shape": [h, w, 3], "dtype": "|u1"};
+    # the frame is read in place through a read-only mmap
+    try:
+        if not models.is_ready():
+            return JSONResponse(status_code=503,content={"error":"Models are still loading"})
+        handle=await request.json()
+        path=os.path.realpath(str(handle.get("path","")))
+        if os.path.dirname(path)!=SHM_DIR or not os.path.basename(path).startswith(SHM_PREFIX) or not os.path.isfile(path):
+            return JSONResponse(status_code=400,content={"error":f"Frame must be a {SHM_PREFIX}* file in {SHM_DIR}"})
+        mapping=FrameMapping(path,writable=False)
+        try:
+            try:
+                frame=mapping.array(int(handle.get("offset",0)),tuple(handle["shape"]),handle.get("dtype","|u1"))
+                check_bgr_frame(frame)
+            except (KeyError,TypeError,ValueError) as e:
+                return JSONResponse(status_code=400,content={"error":f"Bad frame handle: {str(e)}"})
+            response=await recognize_image(frame)
+            del frame
+            return response
+        finally:
+            mapping.close()
+    except Exception as e:
+        logger.error(f"Error processing shared frame: {str(e)}")
+        return JSONResponse(status_code=500,content={"error":"Error processing the image"})
 if __name__=="__main__":
-    uvicorn.run("main:app",host="0.0.0.0",port=8000,reload=True)
\ No newline at end of file
+    # No reload: the reloader would run a second process with its own copy of the models
+    uvicorn.run("main:app",host="0.0.0.0",port=8000,reload=False)
\ No newline at end of file
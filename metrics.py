@@ -0,0 +1,286 @@
+"""
+In-process metrics in the Prometheus text exposition format
+
+Counters and histograms live in a registry and are rendered on request
+by render(); nothing is sent anywhere. Recording a value takes one lock
+and, for histograms, a bisect over the bucket bounds, so instrumentation
+can stay on in production without measurable cost next to detection and
+OCR.
+
+The stage histogram and counters shared by the gate (smart_car_park.py)
+and the API (main.py) are defined at the bottom of this module. Each
+process has its own registry and exposes it on its own /metrics endpoint.
+"""
+import bisect
+import logging
+import threading
+import time
+from contextlib import contextmanager
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+logger = logging.getLogger(__name__)
+
+CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+# Seconds, from a single OCR pass up to a slow burst on the Pi
+DEFAULT_BUCKETS = (0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0)
+
+
+def _format_labels(labelnames, values, extra=None):
+    """Render {name="value",...} for one series"""
+    pairs = list(zip(labelnames, values))
+    if extra is not None:
+        pairs.append(extra)
+    if not pairs:
+        return ""
+    escaped = []
+    for name, value in pairs:
+        value = str(value).replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+        escaped.append(f'{name}="{value}"')
+    return "{" + ",".join(escaped) + "}"
+
+
+def _format_value(value):
+    """Render a sample value the way Prometheus expects"""
+    if value == float("inf"):
+        return "+Inf"
+    if float(value).is_integer():
+        return str(int(value))
+    return repr(float(value))
+
+
+class _Metric:
+    """Common parts of a labelled metric"""
+
+    kind = None
+
+    def __init__(self, name, documentation, labelnames=()):
+        self.name = name
+        self.documentation = documentation
+        self.labelnames = tuple(labelnames)
+        self._series = {}
+        self._lock = threading.Lock()
+
+    def _key(self, labels):
+        """Label values in labelnames order"""
+        if set(labels) != set(self.labelnames):
+            raise ValueError(f"{self.name} expects labels {self.labelnames}, got {tuple(labels)}")
+        return tuple(str(labels[name]) for name in self.labelnames)
+
+    def render(self):
+        """Lines of the text exposition for this metric"""
+        lines = [f"# HELP {self.name} {self.documentation}", f"# TYPE {self.name} {self.kind}"]
+        with self._lock:
+            series = sorted(self._series.items())
+            lines.extend(self._render_series(series))
+        return lines
+
+
+class Counter(_Metric):
+    """Monotonically increasing count, e.g. detection misses"""
+
+    kind = "counter"
+
+    def __init__(self, name, documentation, labelnames=()):
+        # Text format 0.0.4 names the family like its samples, with _total
+        super().__init__(name if name.endswith("_total") else name + "_total", documentation, labelnames)
+
+    def inc(self, amount=1, **labels):
+        """
+        Add to the counter
+
+        Args:
+            amount: Non-negative increment
+            **labels: One value per label name
+        """
+        key = self._key(labels)
+        with self._lock:
+            self._series[key] = self._series.get(key, 0) + amount
+
+    def value(self, **labels):
+        """Current count of one series (0 if never incremented)"""
+        with self._lock:
+            return self._series.get(self._key(labels), 0)
+
+    def _render_series(self, series):
+        for key, value in series:
+            yield f"{self.name}{_format_labels(self.labelnames, key)} {_format_value(value)}"
+
+
+class Histogram(_Metric):
+    """Distribution of durations over fixed buckets"""
+
+    kind = "histogram"
+
+    def __init__(self, name, documentation, labelnames=(), buckets=DEFAULT_BUCKETS):
+        """
+        Args:
+            name: Metric name (seconds by convention)
+            documentation: HELP text
+            labelnames: Label names, e.g. ("stage",)
+            buckets: Increasing upper bounds; +Inf is added
+        """
+        super().__init__(name, documentation, labelnames)
+        self.buckets = tuple(float(bound) for bound in buckets)
+
+    def observe(self, value, **labels):
+        """
+        Record one value
+
+        Args:
+            value: Observed value, usually seconds
+            **labels: One value per label name
+        """
+        key = self._key(labels)
+        index = bisect.bisect_left(self.buckets, value)
+        with self._lock:
+            series = self._series.get(key)
+            if series is None:
+                # Per-bucket counts (last is +Inf), sum, count; made cumulative when rendered
+                series = self._series[key] = [[0] * (len(self.buckets) + 1), 0.0, 0]
+            series[0][index] += 1
+            series[1] += value
+            series[2] += 1
+
+    @contextmanager
+    def time(self, **labels):
+        """Observe the wall time spent in a with block (also when it raises)"""
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.observe(time.perf_counter() - start, **labels)
+
+    def _render_series(self, series):
+        bounds = self.buckets + (float("inf"),)
+        for key, (counts, total, count) in series:
+            cumulative = 0
+            for bound, bucket_count in zip(bounds, counts):
+                cumulative += bucket_count
+                labels = _format_labels(self.labelnames, key, ("le", _format_value(bound)))
+                yield f"{self.name}_bucket{labels} {cumulative}"
+            labels = _format_labels(self.labelnames, key)
+            yield f"{self.name}_sum{labels} {_format_value(total)}"
+            yield f"{self.name}_count{labels} {count}"
+
+
+class Registry:
+    """Set of metrics rendered together on /metrics"""
+
+    def __init__(self):
+        self._metrics = {}
+        self._lock = threading.Lock()
+
+    def _register(self, metric):
+        """Add a metric, or return the one already registered under its name"""
+        with self._lock:
+            existing = self._metrics.get(metric.name)
+            if existing is not None:
+                if type(existing) is not type(metric) or existing.labelnames != metric.labelnames:
+                    raise ValueError(f"Metric {metric.name} is already registered differently")
+                return existing
+            self._metrics[metric.name] = metric
+            return metric
+
+    def counter(self, name, documentation, labelnames=()):
+        """Get or create a counter"""
+        return self._register(Counter(name, documentation, labelnames))
+
+    def histogram(self, name, documentation, labelnames=(), buckets=DEFAULT_BUCKETS):
+        """Get or create a histogram"""
+        return self._register(Histogram(name, documentation, labelnames, buckets))
+
+    def render(self):
+        """
+        Render every metric
+
+        Returns:
+            str: Prometheus text exposition
+        """
+        with self._lock:
+            metrics = list(self._metrics.values())
+        lines = []
+        for metric in metrics:
+            lines.extend(metric.render())
+        return "\n".join(lines) + "\n"
+
+
+REGISTRY = Registry()
+
+
+class MetricsServer:
+    """
+    Minimal HTTP endpoint serving a registry on /metrics
+
+    For processes without a web framework (the gate); the API serves
+    render() through its own /metrics route instead.
+    """
+
+    def __init__(self, port=9100, host="0.0.0.0", registry=REGISTRY):
+        """
+        Initialize the server (start() binds the port)
+
+        Args:
+            port: TCP port to listen on
+            host: Address to bind
+            registry: Registry to serve
+        """
+        self.port = port
+        self.host = host
+        self.registry = registry
+        self._server = None
+        self._thread = None
+
+    def start(self):
+        """Bind the port and serve on a background thread"""
+        registry = self.registry
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.path.split("?")[0] != "/metrics":
+                    self.send_error(404)
+                    return
+                body = registry.render().encode()
+                self.send_response(200)
+                self.send_header("Content-Type", CONTENT_TYPE)
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, format, *args):
+                # Scrapes every few seconds would flood car_park.log
+                pass
+
+        self._server = ThreadingHTTPServer((self.host, self.port), Handler)
+        self._server.daemon_threads = True
+        self._thread = threading.Thread(target=self._server.serve_forever, name="metrics")
+        self._thread.daemon = True
+        self._thread.start()
+        logger.info(f"Serving metrics on http://{self.host}:{self.port}/metrics")
+
+    def stop(self):
+        """Stop serving and release the port"""
+        if self._server is None:
+            return
+        self._server.shutdown()
+        self._server.server_close()
+        self._thread.join(timeout=5)
+        self._server = None
+        self._thread = None
+
+
+# Shared metrics; stages are e.g. camera, detection, ocr, decision, uart_ack
+STAGE_SECONDS = REGISTRY.histogram(
+    "lahu_stage_seconds", "Time spent in one stage of plate recognition or a gate decision", ("stage",))
+DETECTION_MISSES = REGISTRY.counter(
+    "lahu_detection_misses", "Frames in which YOLO found no plate")
+OCR_READS = REGISTRY.counter(
+    "lahu_ocr_reads", "OCR reads by engine: det_rec or rec_only", ("engine",))
+OCR_FALLBACKS = REGISTRY.counter(
+    "lahu_ocr_fallbacks", "OCR reads that needed the slower fallback pass", ("engine",))
+UART_CRC_ERRORS = REGISTRY.counter(
+    "lahu_uart_crc_errors", "Packets from the STM32 rejected for a bad CRC or length", ("lane",))
+UART_RETRIES = REGISTRY.counter(
+    "lahu_uart_retries", "Packets to the STM32 sent again after an ERR, a timeout or an unknown reply", ("lane", "reason"))
+PRE_RECOGNITIONS = REGISTRY.counter(
+    "lahu_pre_recognitions", "Motion-triggered plate reads by what the arrival did with them: used, mismatch or stale", ("lane", "outcome"))
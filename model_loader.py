@@ -0,0 +1,199 @@
+import glob
+import logging
+import os
+import threading
+import time
+
+import cv2
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_WARMUP_DIR = "test_img"
+
+
+def load_warmup_image(directory=DEFAULT_WARMUP_DIR):
+    """
+    Load the first bundled sample image
+
+    Returns:
+        BGR image, or None if the directory has no readable image
+    """
+    for path in sorted(glob.glob(os.path.join(directory, "*.jpg"))):
+        image = cv2.imread(path)
+        if image is not None:
+            return image
+    return None
+
+
+def warm_up(detector, ocr, directory=DEFAULT_WARMUP_DIR):
+    """
+    Run one detection and one OCR read on a sample image
+
+    The first inference of each model pays for lazy allocation and
+    kernel selection; doing it here keeps that off the first car.
+
+    Args:
+        detector: LicensePlateDetector
+        ocr: OCRReader
+        directory: Directory of sample images
+    """
+    image = load_warmup_image(directory)
+    if image is None:
+        logger.warning(f"No warm-up image found in {directory}, skipping warm-up")
+        return
+    crop = detector.warm_up(image)
+    ocr.warm_up(crop if crop is not None and crop.size else image)
+
+
+class ModelLoader:
+    """
+    Builds the recognition models in parallel on background threads
+
+    Every factory runs on its own thread, so torch/ultralytics and paddle
+    import and load at the same time instead of one after the other. Once
+    all of them have finished, the optional warm-up runs and the loader
+    reports ready. Until then callers check is_ready() and answer without
+    the models, so a restart does not hold up the rest of the process.
+    """
+
+    def __init__(self, factories, warmup=None, name="models"):
+        """
+        Initialize the loader (start() begins loading)
+
+        Args:
+            factories: dict of model name -> callable returning the model
+            warmup: Optional callable receiving the dict of loaded models
+            name: Thread name prefix
+        """
+        self.factories = dict(factories)
+        self.warmup = warmup
+        self.name = name
+        self.models = {}
+        self.status = {model: "pending" for model in self.factories}
+        self.error = None
+        self.started_at = None
+        self.finished_at = None
+        self._ready = threading.Event()
+        self._done = threading.Event()
+        self._callbacks = []
+        self._lock = threading.Lock()
+
+    def start(self):
+        """Start loading in the background and return immediately"""
+        self.started_at = time.monotonic()
+        thread = threading.Thread(target=self._run, name=f"{self.name}-loader")
+        thread.daemon = True
+        thread.start()
+
+    def load(self):
+        """Load in the calling thread and return when ready (or failed)"""
+        self.started_at = time.monotonic()
+        self._run()
+        return self.is_ready()
+
+    def on_ready(self, callback):
+        """
+        Call callback(models) once loading succeeds (immediately if it already has)
+
+        Callbacks registered before then run on the loader thread.
+        """
+        with self._lock:
+            if not self._ready.is_set():
+                self._callbacks.append(callback)
+                return
+        callback(self.models)
+
+    def is_ready(self):
+        """True once every model is loaded and warmed up"""
+        return self._ready.is_set()
+
+    @property
+    def failed(self):
+        """True if a model could not be loaded"""
+        return self.error is not None
+
+    def wait(self, timeout=None):
+        """
+        Block until loading has finished
+
+        Returns:
+            bool: True if ready, False on failure or timeout
+        """
+        self._done.wait(timeout)
+        return self.is_ready()
+
+    def get(self, model):
+        """Get a loaded model (None while loading)"""
+        return self.models.get(model)
+
+    def report(self):
+        """
+        Readiness summary
+
+        Returns:
+            dict: state ('starting', 'ready' or 'failed'), per-model status,
+            seconds spent loading and the error, if any
+        """
+        if self.is_ready():
+            state = "ready"
+        elif self.failed:
+            state = "failed"
+        else:
+            state = "starting"
+        end = self.finished_at or time.monotonic()
+        return {
+            "state": state,
+            "models": dict(self.status),
+            "seconds": round(end - self.started_at, 2) if self.started_at else 0.0,
+            "error": self.error,
+        }
+
+    def _build(self, model, factory):
+        """Loader thread: build one model"""
+        self.status[model] = "loading"
+        start = time.monotonic()
+        try:
+            self.models[model] = factory()
+            self.status[model] = "loaded"
+            logger.info(f"Loaded {model} in {time.monotonic() - start:.1f}s")
+        except Exception as e:
+            self.status[model] = "failed"
+            self.error = f"{model}: {str(e)}"
+            logger.error(f"Failed to load {model}: {str(e)}")
+
+    def _run(self):
+        """Build every model in parallel, warm them up and report readiness"""
+        threads = []
+        for model, factory in self.factories.items():
+            thread = threading.Thread(target=self._build, args=(model, factory), name=f"{self.name}-{model}")
+            thread.daemon = True
+            thread.start()
+            threads.append(thread)
+        for thread in threads:
+            thread.join()
+
+        if not self.failed and self.warmup is not None:
+            start = time.monotonic()
+            try:
+                self.warmup(self.models)
+                logger.info(f"Warm-up finished in {time.monotonic() - start:.1f}s")
+            except Exception as e:
+                # The models work without it; only the first read is slower
+                logger.warning(f"Warm-up failed: {str(e)}")
+
+        self.finished_at = time.monotonic()
+        if not self.failed:
+            # Callbacks run before is_ready() turns true, so nobody sees ready
+            # before they have wired the models in
+            with self._lock:
+                for callback in self._callbacks:
+                    try:
+                        callback(self.models)
+                    except Exception as e:
+                        logger.error(f"Error in model ready callback: {str(e)}")
+                self._callbacks = []
+                for model in self.status:
+                    self.status[model] = "ready"
+                self._ready.set()
+            logger.info(f"Models ready after {self.finished_at - self.started_at:.1f}s")
+        self._done.set()
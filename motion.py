@@ -0,0 +1,131 @@
+import logging
+import threading
+import time
+
+import numpy as np
+
+logger = logging.getLogger(__name__)
+
+
+class MotionDetector:
+    """
+    Cheap frame-difference motion trigger for a CameraCapture
+
+    Every interval seconds the newest frame is shrunk to a small grey
+    thumbnail and compared with the previous one. When the share of
+    pixels that changed by more than pixel_threshold crosses min_changed,
+    something is moving. on_motion(event) is then called:
+    - "start" when motion begins,
+    - "moving" every repeat seconds while it lasts,
+    - "settled" once the scene has been still for still_time, which is
+      usually a car that has stopped in front of the barrier.
+    Comparing consecutive thumbnails (rather than a fixed background)
+    lets a slow lighting change or a parked car go unnoticed.
+    """
+
+    EVENTS = ("start", "moving", "settled")
+
+    def __init__(self, camera, on_motion, size=(80, 45), interval=0.1, pixel_threshold=25,
+                 min_changed=0.02, still_time=0.5, repeat=1.0, name="motion"):
+        """
+        Initialize the detector (start() begins polling)
+
+        Args:
+            camera: CameraCapture to watch
+            on_motion: Callable receiving "start", "moving" or "settled"; runs on
+                the detector thread, so it should only queue work
+            size: (width, height) of the thumbnails compared
+            interval: Seconds between thumbnails
+            pixel_threshold: Grey level change that counts a pixel as changed
+            min_changed: Fraction of changed pixels that counts as motion
+            still_time: Seconds without motion before "settled"
+            repeat: Seconds between "moving" events
+            name: Thread name
+        """
+        self.camera = camera
+        self.on_motion = on_motion
+        self.size = size
+        self.interval = interval
+        self.pixel_threshold = pixel_threshold
+        self.min_changed = min_changed
+        self.still_time = still_time
+        self.repeat = repeat
+        self.name = name
+        self.running = False
+        self.moving = False
+        self.events = 0
+        self._previous = None
+        self._last_motion = 0.0
+        self._last_event = 0.0
+        self._thread = None
+
+    def start(self):
+        """Start polling the camera"""
+        if self.running:
+            return
+        self.running = True
+        self._thread = threading.Thread(target=self._run, name=self.name)
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop polling the camera"""
+        self.running = False
+        if self._thread:
+            self._thread.join(timeout=2)
+            self._thread = None
+
+    def update(self, thumbnail, now=None):
+        """
+        Compare one thumbnail with the previous one
+
+        Args:
+            thumbnail: Greyscale image of the configured size
+            now: Timestamp (defaults to time.monotonic())
+
+        Returns:
+            str: The event to report, or None
+        """
+        now = time.monotonic() if now is None else now
+        frame = thumbnail.astype(np.int16)
+        previous, self._previous = self._previous, frame
+        if previous is None or previous.shape != frame.shape:
+            return None
+
+        changed = np.count_nonzero(np.abs(frame - previous) > self.pixel_threshold) / frame.size
+
+        if changed >= self.min_changed:
+            self._last_motion = now
+            if not self.moving:
+                self.moving = True
+                self._last_event = now
+                return "start"
+            if now - self._last_event >= self.repeat:
+                self._last_event = now
+                return "moving"
+        elif self.moving and now - self._last_motion >= self.still_time:
+            self.moving = False
+            self._last_event = now
+            return "settled"
+        return None
+
+    def _run(self):
+        """Detector loop: poll thumbnails and report motion events"""
+        last_seq = -1
+        while self.running:
+            time.sleep(self.interval)
+            try:
+                seq, thumbnail = self.camera.thumbnail(self.size)
+                if thumbnail is None or seq == last_seq:
+                    continue
+                last_seq = seq
+                event = self.update(thumbnail)
+            except Exception as e:
+                logger.error(f"Error in motion detector: {str(e)}")
+                continue
+            if event is not None:
+                self.events += 1
+                try:
+                    self.on_motion(event)
+                except Exception as e:
+                    logger.error(f"Error in motion callback: {str(e)}")
@@ -0,0 +1,151 @@
+import logging
+import threading
+import time
+
+logger = logging.getLogger(__name__)
+
+
+class OccupancyTracker:
+    """
+    Plates currently inside the lot, checked against the lot capacity
+
+    The occupancy table is maintained by triggers on movement_log (an
+    entry adds the plate, an exit removes it), so it survives restarts,
+    stays correct when old log months are archived, and load() reads it
+    without scanning the log. enter()/exit() update an in-memory set
+    directly, which is O(1) and holds the lock only for the set update.
+
+    Gates in other processes (e.g. a separate exit controller) write the
+    same table, so a background thread polls the occupancy_version
+    counter (bumped by triggers on every change) and reloads the set when
+    it moved, like PlateIndex does for plates. A move made here reaches
+    the table only when the movement log writer flushes it; until the
+    table agrees, or pending_timeout passes, it is re-applied on top of
+    every reload, so a reload never forgets a car that has just entered.
+    """
+
+    def __init__(self, db, capacity=100, poll_interval=1.0, pending_timeout=30.0, on_full=None):
+        """
+        Initialize the tracker (call load() or start() before use)
+
+        Args:
+            db: db.Database instance
+            capacity: Number of parking spaces
+            poll_interval: Seconds between version checks
+            pending_timeout: Seconds a local move not yet in the table is re-applied
+            on_full: Optional callable receiving True or False when a reload
+                (i.e. another process) fills or frees the lot
+        """
+        self.db = db
+        self.capacity = capacity
+        self.poll_interval = poll_interval
+        self.pending_timeout = pending_timeout
+        self.on_full = on_full
+        self.version = None
+        self._inside = set()
+        self._local = {}  # plate -> (inside, time moved) for moves not yet seen in the table
+        self._lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread = None
+
+    def load(self):
+        """
+        Load the plates currently inside from the occupancy table
+
+        Returns:
+            tuple: (was_full, now_full) around the reload
+        """
+        with self.db.connection() as conn:
+            # One read transaction so version and rows are consistent
+            with conn:
+                conn.execute("BEGIN")
+                version = conn.execute("SELECT version FROM occupancy_version WHERE id = 1").fetchone()[0]
+                inside = {row[0] for row in conn.execute("SELECT plate_number FROM occupancy")}
+        now = time.monotonic()
+        with self._lock:
+            was_full = len(self._inside) >= self.capacity
+            for plate, (entered, moved_at) in list(self._local.items()):
+                if (plate in inside) == entered or now - moved_at > self.pending_timeout:
+                    del self._local[plate]
+                elif entered:
+                    inside.add(plate)
+                else:
+                    inside.discard(plate)
+            self._inside = inside
+            self.version = version
+            now_full = len(inside) >= self.capacity
+        logger.info(f"Lot occupancy: {len(inside)}/{self.capacity} (version {version})")
+        return was_full, now_full
+
+    def start(self):
+        """Load the occupancy and start following other processes' moves"""
+        self.load()
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._watch, name="occupancy")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop following changes"""
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=2)
+            self._thread = None
+
+    def _watch(self):
+        """Reload the set whenever the version counter moves"""
+        while not self._stop.wait(self.poll_interval):
+            try:
+                row = self.db.fetchone("SELECT version FROM occupancy_version WHERE id = 1")
+                if row is None or row[0] == self.version:
+                    continue
+                was_full, now_full = self.load()
+                if now_full != was_full and self.on_full is not None:
+                    self.on_full(now_full)
+            except Exception as e:
+                logger.error(f"Error refreshing lot occupancy: {str(e)}")
+
+    def is_full(self):
+        """True if no space is left"""
+        return len(self._inside) >= self.capacity
+
+    def is_inside(self, plate_number):
+        """True if the plate entered and has not left"""
+        return plate_number in self._inside
+
+    def enter(self, plate_number):
+        """
+        Record a plate entering
+
+        A plate already inside (e.g. its exit was missed) keeps its space
+        instead of taking a second one.
+
+        Returns:
+            tuple: (admitted, now_full)
+        """
+        with self._lock:
+            if plate_number not in self._inside:
+                if len(self._inside) >= self.capacity:
+                    return False, True
+                self._inside.add(plate_number)
+                self._local[plate_number] = (True, time.monotonic())
+            return True, len(self._inside) >= self.capacity
+
+    def exit(self, plate_number):
+        """
+        Record a plate leaving
+
+        Returns:
+            tuple: (was_inside, was_full), where was_full means a space
+            just became free in a full lot
+        """
+        with self._lock:
+            was_full = len(self._inside) >= self.capacity
+            if plate_number not in self._inside:
+                return False, False
+            self._inside.discard(plate_number)
+            self._local[plate_number] = (False, time.monotonic())
+            return True, was_full and len(self._inside) < self.capacity
+
+    def __len__(self):
+        return len(self._inside)
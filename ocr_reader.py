@@ -1,10 +1,59 @@
-import logging,cv2,numpy as np,os,re
-from paddleocr import PaddleOCR
+import logging,cv2,numpy as np,os,re,threading
+from metrics import OCR_READS,OCR_FALLBACKS
+from parser import normalize_plate,match_plate_format
 logger=logging.getLogger(__name__)
 os.environ['CUDA_VISIBLE_DEVICES']='-1'
+def _buffer(buffers,name,shape):
+    # Contiguous uint8 view of a backing array kept in buffers that only grows
+    backing=getattr(buffers,name,None)
+    needed=shape[0]*shape[1]
+    if backing is None or backing.size<needed:
+        backing=np.empty(needed,np.uint8)
+        setattr(buffers,name,backing)
+    return backing[:needed].reshape(shape)
+# Grey, upscale to at most 400 px high, adaptive threshold to dark text on white.
+# THRESH_BINARY gives the inverse of THRESH_BINARY_INV directly, so the former
+# bitwise_not (and a 1x1 open, which is a no-op) are gone. With buffers (e.g. a
+# threading.local) every step writes into arrays that are reused from plate to
+# plate, and the result is overwritten by the next call with the same buffers.
+def preprocess_plate(image,buffers=None,interpolation=cv2.INTER_CUBIC):
+    buffers=buffers if buffers is not None else threading.local()
+    height,width=image.shape[:2]
+    gray=image if image.ndim==2 else cv2.cvtColor(image,cv2.COLOR_BGR2GRAY,dst=_buffer(buffers,'gray',(height,width)))
+    scale=min(height*2,400)/height
+    # Same output size as resize computes from fx/fy (cvRound, like round()); fx/fy keep its pixel mapping
+    shape=(round(height*scale),round(width*scale))
+    resized=cv2.resize(gray,None,dst=_buffer(buffers,'resized',shape),fx=scale,fy=scale,interpolation=interpolation)
+    return cv2.adaptiveThreshold(resized,255,cv2.ADAPTIVE_THRESH_GAUSSIAN_C,cv2.THRESH_BINARY,11,2,dst=_buffer(buffers,'binary',shape))
 class OCRReader:
-    def __init__(self,lang='en',use_angle_cls=True,det=True,rec=True):
+    REC_HEIGHT=48
+    # Upscaling before thresholding stays bicubic; bilinear is cheaper but changes
+    # the binarized crop, so switch only after a labelled benchmark.py recognition run
+    PREPROCESS_INTERPOLATION=cv2.INTER_CUBIC
+    TWO_ROW_ASPECT=0.45
+    # mode='cascade' runs a cheap raw pass first and only falls back to the
+    # preprocessed pass with angle classification when that result fails the
+    # plate format checks or is below fallback_conf; mode='double' always runs both.
+    # engine='rec' skips PaddleOCR text detection on the (already tight) YOLO crop
+    # and recognizes fixed-height strips directly, falling back to det+rec when
+    # the result does not validate; engine='det_rec' always uses det+rec
+    def __init__(self,lang='en',use_angle_cls=True,det=True,rec=True,mode='cascade',fallback_conf=0.85,engine='det_rec'):
+        if mode not in ('cascade','double'):
+            raise ValueError(f"Unknown OCR mode: {mode}")
+        if engine not in ('det_rec','rec'):
+            raise ValueError(f"Unknown OCR engine: {engine}")
+        if engine=='rec' and not (det and rec):
+            raise ValueError("engine='rec' needs det and rec models for its fallback")
+        self.mode=mode
+        self.engine=engine
+        self.fallback_conf=fallback_conf
+        self.use_angle_cls=use_angle_cls
+        self._stats_lock=threading.Lock()
+        self._buffers=threading.local()  # preprocess_plate buffers, one set per thread
+        self.stats={'reads':0,'fallbacks':0,'rec_only_reads':0,'rec_only_fallbacks':0}
         try:
+            # paddle is only imported when a reader is built, so importing this module stays cheap
+            from paddleocr import PaddleOCR
             self.ocr=PaddleOCR(use_angle_cls=use_angle_cls,lang=lang,det=det,rec=rec,use_gpu=False)
             logger.info("PaddleOCR initialized successfully (CPU mode)")
         except Exception as e:
@@ -12,108 +61,160 @@ class OCRReader:
             raise
     def preprocess_image(self,image):
         try:
-            gray=cv2.cvtColor(image,cv2.COLOR_BGR2GRAY)
-            height,width=gray.shape[:2]
-            target_height=min(height*2,400)
-            scale=target_height/height
-            resized=cv2.resize(gray,None,fx=scale,fy=scale,interpolation=cv2.INTER_CUBIC)
-            binary=cv2.adaptiveThreshold(resized,255,cv2.ADAPTIVE_THRESH_GAUSSIAN_C,cv2.THRESH_BINARY_INV,11,2)
-            kernel=np.ones((1,1),np.uint8)
-            denoised=cv2.morphologyEx(binary,cv2.MORPH_OPEN,kernel)
-            denoised=cv2.bitwise_not(denoised)
-            return denoised
+            return preprocess_plate(image,self._buffers,self.PREPROCESS_INTERPOLATION)
         except Exception as e:
             logger.error(f"Error in preprocessing: {str(e)}")
             return image
     def read_text(self,image):
+        return self.read_text_with_confidence(image)[0]
+    def read_text_with_confidence(self,image):
+        try:
+            if self.engine=='rec':
+                text,conf=self._read_rec_only(image)
+                valid=match_plate_format(text) is not None
+                self._count_rec_only(not (valid and conf>=self.fallback_conf))
+                if valid and conf>=self.fallback_conf:
+                    return text,conf
+                logger.info(f"Recognition-only pass gave {text!r} ({conf:.2f}), falling back to det+rec")
+            if self.mode=='double':
+                return self._read_double(image)
+            return self._read_cascade(image)
+        except Exception as e:
+            logger.error(f"Error in OCR processing: {str(e)}")
+            return None,0.0
+    def warm_up(self,image):
+        # Run each PaddleOCR pass once (rec-only, raw det+rec, preprocessed with cls)
+        # so the first real read does not pay for allocation; stats are not counted
+        if self.engine=='rec':
+            self.ocr.ocr(self._to_strip(image),det=False,cls=False)
+        self.ocr.ocr(image,cls=False)
+        self.ocr.ocr(self.preprocess_image(image),cls=self.use_angle_cls)
+    def get_stats(self):
+        with self._stats_lock:
+            stats=dict(self.stats)
+        stats['fallback_rate']=stats['fallbacks']/stats['reads'] if stats['reads'] else 0.0
+        stats['rec_only_fallback_rate']=stats['rec_only_fallbacks']/stats['rec_only_reads'] if stats['rec_only_reads'] else 0.0
+        return stats
+    def _count(self,fallback):
+        with self._stats_lock:
+            self.stats['reads']+=1
+            if fallback:
+                self.stats['fallbacks']+=1
+        OCR_READS.inc(engine='det_rec')
+        if fallback:
+            OCR_FALLBACKS.inc(engine='det_rec')
+    def _count_rec_only(self,fallback):
+        with self._stats_lock:
+            self.stats['rec_only_reads']+=1
+            if fallback:
+                self.stats['rec_only_fallbacks']+=1
+        OCR_READS.inc(engine='rec_only')
+        if fallback:
+            OCR_FALLBACKS.inc(engine='rec_only')
+    def _split_rows(self,image):
+        height,width=image.shape[:2]
+        # Single-line car plates are wide; square plates carry two rows
+        if height<2*self.REC_HEIGHT//3 or height/width<self.TWO_ROW_ASPECT:
+            return [image]
+        gray=cv2.cvtColor(image,cv2.COLOR_BGR2GRAY) if image.ndim==3 else image
+        _,binary=cv2.threshold(gray,0,255,cv2.THRESH_BINARY_INV+cv2.THRESH_OTSU)
+        # Cut at the row with the least ink in the middle band
+        lo,hi=int(height*0.35),int(height*0.65)
+        ink=binary[lo:hi].sum(axis=1)
+        cut=lo+int(np.argmin(ink)) if ink.size else height//2
+        return [image[:cut],image[cut:]]
+    def _to_strip(self,image):
+        height,width=image.shape[:2]
+        scale=self.REC_HEIGHT/height
+        interpolation=cv2.INTER_AREA if scale<1 else cv2.INTER_LINEAR
+        return cv2.resize(image,(max(1,int(round(width*scale))),self.REC_HEIGHT),interpolation=interpolation)
+    def _read_rec_only(self,image):
+        texts=[]
+        confs=[]
+        for row in self._split_rows(image):
+            if row.size==0:
+                return None,0.0
+            results=self.ocr.ocr(self._to_strip(row),det=False,cls=False)
+            lines=self._lines(results)
+            if not lines:
+                return None,0.0
+            text,conf=lines[0]
+            texts.append(normalize_plate(text))
+            confs.append(conf)
+        return ''.join(texts),min(confs)
+    def _read_double(self,image):
+        preprocessed=self.preprocess_image(image)
+        results1=self.ocr.ocr(image,cls=self.use_angle_cls)
+        results2=self.ocr.ocr(preprocessed,cls=self.use_angle_cls)
+        all_results=self._lines(results1)+self._lines(results2)
+        self._count(True)
+        return self._select_text(all_results)
+    def _read_cascade(self,image):
+        first=self._lines(self.ocr.ocr(image,cls=False))
+        text,conf=self._select_text(first) if first else (None,0.0)
+        if conf>=self.fallback_conf and match_plate_format(text) is not None:
+            self._count(False)
+            return text,conf
+        logger.info(f"Cheap OCR pass gave {text!r} ({conf:.2f}), falling back to preprocessed pass")
+        self._count(True)
+        preprocessed=self.preprocess_image(image)
+        second=self._lines(self.ocr.ocr(preprocessed,cls=self.use_angle_cls))
+        return self._select_text(first+second)
+    def _lines(self,results):
+        if results and len(results)>0 and results[0]:
+            return list(results[0])
+        return []
+    def _select_text(self,all_results):
+        # Every line is normalized and ranked by confidence once; the format
+        # checks below then run on the cleaned strings without re-cleaning
         try:
-            preprocessed=self.preprocess_image(image)
-            results1=self.ocr.ocr(image,cls=True)
-            results2=self.ocr.ocr(preprocessed,cls=True)
-            all_results=[]
-            if results1 and len(results1)>0 and results1[0]:
-                all_results.extend(results1[0])
-            if results2 and len(results2)>0 and results2[0]:
-                all_results.extend(results2[0])
             if not all_results:
                 logger.warning("No text detected in license plate")
-                return None
-            vertical_results=[]
-            for res in all_results:
-                box=res[0]
-                y_center=(box[0][1]+box[2][1])/2
-                vertical_results.append((y_center,res[1][0],res[1][1]))
-            vertical_results.sort(key=lambda x:x[0])
-            if len(vertical_results)>1 and abs(vertical_results[0][0]-vertical_results[1][0])>10:
+                return None,0.0
+            lines=[((res[0][0][1]+res[0][2][1])/2,normalize_plate(res[1][0]),res[1][1]) for res in all_results]
+            by_position=sorted(lines,key=lambda x:x[0])
+            if len(by_position)>1 and abs(by_position[0][0]-by_position[1][0])>10:
                 logger.info("Detected multi-line plate (motorcycle)")
                 line_groups={}
-                for y_pos,text,conf in vertical_results:
-                    y_group=round(y_pos/10)*10
-                    if y_group not in line_groups:
-                        line_groups[y_group]=[]
-                    line_groups[y_group].append((text,conf))
-                lines_with_conf=[]
-                for y_group,texts in sorted(line_groups.items()):
-                    texts.sort(key=lambda x:x[1],reverse=True)
-                    best_text=texts[0][0]
-                    best_conf=texts[0][1]
-                    cleaned_text=''.join(ch for ch in best_text if ch.isalnum()).upper()
-                    lines_with_conf.append((cleaned_text,best_conf))
+                for y_pos,text,conf in by_position:
+                    line_groups.setdefault(round(y_pos/10)*10,[]).append((text,conf))
+                lines_with_conf=[max(texts,key=lambda x:x[1]) for _,texts in sorted(line_groups.items())]
                 combined_text=''.join(text for text,_ in lines_with_conf)
-                if self._is_valid_motorcycle_plate(combined_text):
+                plate=match_plate_format(combined_text)
+                if plate is not None and plate.motorcycle:
                     logger.info(f"Valid motorcycle plate recognized: {combined_text}")
-                    return combined_text
+                    return combined_text,min(conf for _,conf in lines_with_conf)
                 logger.info(f"Multi-line texts detected but not valid format: {combined_text}")
-            all_results.sort(key=lambda x:x[1][1],reverse=True)
-            text_with_conf=[(res[1][0],res[1][1]) for res in all_results]
-            plate_pattern=re.compile(r'^(\d{2}[A-Za-z][0-9]{4,5})$')
-            for text,conf in text_with_conf:
-                cleaned=''.join(ch for ch in text if ch.isalnum()).upper()
-                if plate_pattern.match(cleaned) and conf>0.8:
-                    logger.info(f"Found high-confidence complete plate: {cleaned}")
-                    return cleaned
-            all_texts=[]
-            for text,_ in text_with_conf:
-                cleaned_text=''.join(ch for ch in text if ch.isalnum()).upper()
-                all_texts.append(cleaned_text)
-            final_text=""
-            if all_texts:
-                candidate=all_texts[0]
-                if len(candidate)>=156:
-                    half_length=len(candidate)//2
-                    first_half=candidate[:half_length]
-                    second_half=candidate[half_length:]
-                    if self._similarity_score(first_half,second_half)>0.6:
-                        if self._is_valid_plate(first_half):
-                            final_text=first_half
-                        else:
-                            final_text=second_half
-                        logger.info(f"Detected and fixed duplicate: {candidate} -> {final_text}")
-                    else:
-                        final_text=candidate
-                else:
-                    final_text=candidate
+            ranked=sorted(((text,conf) for _,text,conf in lines),key=lambda x:x[1],reverse=True)
+            for text,conf in ranked:
+                if conf<=0.8:
+                    break
+                plate=match_plate_format(text)
+                if plate is not None and plate.car:
+                    logger.info(f"Found high-confidence complete plate: {text}")
+                    return text,conf
+            final_text,final_conf=ranked[0]
+            if len(final_text)>=156:
+                half_length=len(final_text)//2
+                first_half=final_text[:half_length]
+                second_half=final_text[half_length:]
+                if self._similarity_score(first_half,second_half)>0.6:
+                    candidate=final_text
+                    final_text=first_half if self._is_valid_plate(first_half) else second_half
+                    logger.info(f"Detected and fixed duplicate: {candidate} -> {final_text}")
             logger.info(f"Extracted text: {final_text}")
-            return final_text
+            return final_text,final_conf
         except Exception as e:
-            logger.error(f"Error in OCR processing: {str(e)}")
-            return None
+            logger.error(f"Error selecting OCR text: {str(e)}")
+            return None,0.0
     def _similarity_score(self,str1,str2):
         if not str1 or not str2:
             return 0
         matches=sum(c1==c2 for c1,c2 in zip(str1,str2))
         return matches/max(len(str1),len(str2))
     def _is_valid_plate(self,text):
-        patterns=[r'^\d{2}[A-Z][0-9]{4,5}$',r'^\d{2}[A-Z][0-9]{3}\.[0-9]{2}$']
-        cleaned=''.join(ch for ch in text if ch.isalnum()).upper()
-        for pattern in patterns:
-            if re.match(pattern,cleaned):
-                return True
-        return False
+        plate=match_plate_format(text)
+        return plate is not None and plate.car
     def _is_valid_motorcycle_plate(self,text):
-        patterns=[r'^\d{2}[A-Z][0-9]{5,6}$',r'^\d{2}[A-Z][0-9]{2,3}\d{3}$']
-        cleaned=''.join(ch for ch in text if ch.isalnum()).upper()
-        for pattern in patterns:
-            if re.match(pattern,cleaned):
-                return True
-        return False
\ No newline at end of file
+        plate=match_plate_format(text)
+        return plate is not None and plate.motorcycle
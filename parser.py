@@ -1,8 +1,62 @@
 import logging
 import re
+from collections import namedtuple
+from functools import lru_cache
 
 logger = logging.getLogger(__name__)
 
+# Everything but ASCII letters and digits, removed after upper-casing
+NON_ALNUM = re.compile(r'[^0-9A-Z]+')
+
+# Car and motorcycle plates in one pattern: localID (2 digits), the series
+# letter, then the serial. Car serials have 4 or 5 digits, motorcycle serials
+# (two-row plates read top to bottom) 5 or 6, so a 5 digit serial fits both.
+PLATE_FORMAT = re.compile(r'(?P<localID>[0-9]{2})(?P<modelID>[A-Z])(?P<mainID>[0-9]{4,6})')
+
+# PlateParser's looser format: the modelID may be 1 or 2 alphanumerics
+PARSER_FORMAT = re.compile(r'(?P<localID>[0-9]{2})(?P<modelID>[A-Z0-9]{1,2})(?P<mainID>[0-9]{4,5})')
+MAIN_ID = re.compile(r'[0-9]{4,5}$')
+
+PlateFormat = namedtuple("PlateFormat", "plate localID modelID mainID car motorcycle")
+
+
+def normalize_plate(text):
+    """
+    Upper-case OCR text and drop everything but letters and digits
+    
+    Args:
+        text: Raw OCR text (None is treated as empty)
+        
+    Returns:
+        Normalized text
+    """
+    return NON_ALNUM.sub('', text.upper()) if text else ""
+
+
+@lru_cache(maxsize=1024)
+def match_plate_format(text):
+    """
+    Normalize OCR text and match it against the car and motorcycle formats
+    
+    Both formats are checked by one precompiled pattern in a single pass,
+    and results are cached because the OCR cascade and the burst vote see
+    the same strings again and again.
+    
+    Args:
+        text: Raw OCR text
+        
+    Returns:
+        PlateFormat (plate, localID, modelID, mainID, car, motorcycle) or
+        None if the text fits neither format
+    """
+    plate = normalize_plate(text)
+    match = PLATE_FORMAT.fullmatch(plate)
+    if match is None:
+        return None
+    serial = len(match.group('mainID'))
+    return PlateFormat(plate, *match.groups(), car=serial <= 5, motorcycle=serial >= 5)
+
+
 class PlateParser:
     """
     Class for parsing license plate text according to the format rules
@@ -17,51 +71,58 @@ class PlateParser:
         # localID: 2 digits
         # modelID: 1 or 2 alphanumeric characters
         # mainID: 4 or 5 digits
-        self.plate_pattern = re.compile(r'^(\d{2})([A-Za-z0-9]{1,2})(\d{4,5})$')
+        self.plate_pattern = PARSER_FORMAT
         
-        # Fallback patterns for partial matches
-        self.localID_pattern = re.compile(r'^\d{2}')
-        self.modelID_pattern = re.compile(r'[A-Za-z0-9]{1,2}')
-        self.mainID_pattern = re.compile(r'\d{4,5}$')
+        # Fallback pattern for partial matches
+        self.mainID_pattern = MAIN_ID
+    
+    # Look-alike corrections, only applied where the plate format fixes the
+    # character class: localID and the trailing mainID digits are always
+    # digits, the first modelID character is always a letter
+    LETTER_TO_DIGIT = {
+        'O': '0',  # Letter O to zero
+        'D': '0',  # Sometimes D is mistaken for 0
+        'Q': '0',  # Sometimes Q is mistaken for 0
+        'I': '1',  # Letter I to one
+        'Z': '2',  # Sometimes Z is mistaken for 2
+        'S': '5',  # Sometimes S is mistaken for 5
+        'G': '6',  # Sometimes G is mistaken for 6
+        'B': '8',  # Sometimes B is mistaken for 8
+    }
+    DIGIT_TO_LETTER = {
+        '0': 'D',
+        '2': 'Z',
+        '5': 'S',
+        '6': 'G',
+        '8': 'B',
+    }
+    # Translation tables, so each span is corrected in one str.translate call
+    LETTER_TO_DIGIT_TABLE = str.maketrans(LETTER_TO_DIGIT)
+    DIGIT_TO_LETTER_TABLE = str.maketrans(DIGIT_TO_LETTER)
     
     def clean_text(self, text):
         """
         Clean the OCR output for better parsing
         
+        Corrections depend on the character position, so letters that are a
+        legitimate part of the series (e.g. the B in 29B12345) are kept.
+        
         Args:
             text: Raw OCR output
             
         Returns:
             Cleaned text
         """
-        if not text:
-            return ""
-            
-        # Remove common OCR errors and normalize characters
-        replacements = {
-            'O': '0',  # Letter O to zero
-            'I': '1',  # Letter I to one
-            'Z': '2',  # Sometimes Z is mistaken for 2
-            'S': '5',  # Sometimes S is mistaken for 5
-            'B': '8',  # Sometimes B is mistaken for 8
-            'G': '6',  # Sometimes G is mistaken for 6
-            'D': '0',  # Sometimes D is mistaken for 0
-            'Q': '0',  # Sometimes Q is mistaken for 0
-            ' ': '',   # Remove spaces
-            '-': '',   # Remove hyphens
-            '.': '',   # Remove periods
-            ',': '',   # Remove commas
-        }
-        
-        # Apply replacements
-        cleaned = text.upper()
-        for old, new in replacements.items():
-            cleaned = cleaned.replace(old, new)
-        
-        # Remove non-alphanumeric characters
-        cleaned = re.sub(r'[^A-Z0-9]', '', cleaned)
+        # Remove spaces, hyphens, periods and anything else non-alphanumeric
+        chars = normalize_plate(text)
         
-        return cleaned
+        # localID: two digits; first modelID character: a letter;
+        # mainID: the last four characters are digits for both 4 and 5 digit serials
+        tail = max(3, len(chars) - 4)
+        return (chars[:2].translate(self.LETTER_TO_DIGIT_TABLE)
+                + chars[2:3].translate(self.DIGIT_TO_LETTER_TABLE)
+                + chars[3:tail]
+                + chars[tail:].translate(self.LETTER_TO_DIGIT_TABLE))
     
     def parse(self, text):
         """
@@ -82,9 +143,9 @@ class PlateParser:
         logger.info(f"Cleaned text for parsing: {cleaned_text}")
         
         # Try exact pattern match first
-        match = self.plate_pattern.match(cleaned_text)
+        match = self.plate_pattern.fullmatch(cleaned_text)
         if match:
-            localID, modelID, mainID = match.groups()
+            localID, modelID, mainID = match.group('localID', 'modelID', 'mainID')
             logger.info(f"Exact match found: localID={localID}, modelID={modelID}, mainID={mainID}")
             return {
                 "localID": localID,
@@ -95,25 +156,19 @@ class PlateParser:
         
         # If exact match fails, try best-effort parsing
         try:
-            # Try to extract each part separately
-            localID_match = self.localID_pattern.search(cleaned_text)
-            localID = localID_match.group(0) if localID_match else ""
-            
-            # For modelID, find characters after the localID
+            # The cleaned text is all alphanumeric, so the parts are plain slices:
+            # two leading digits, the next two characters, then a trailing serial
+            localID = cleaned_text[:2] if len(cleaned_text) >= 2 and cleaned_text[:2].isdigit() else ""
+            modelID = ""
+            mainID = ""
             if localID and len(cleaned_text) > 2:
                 rest = cleaned_text[2:]
-                modelID_candidates = self.modelID_pattern.findall(rest)
-                modelID = modelID_candidates[0] if modelID_candidates else ""
+                modelID = rest[:2]
                 
                 # Try to find mainID after modelID
-                if modelID and len(rest) > len(modelID):
-                    mainID_match = self.mainID_pattern.search(rest[len(modelID):])
+                if len(rest) > len(modelID):
+                    mainID_match = self.mainID_pattern.search(rest, len(modelID))
                     mainID = mainID_match.group(0) if mainID_match else ""
-                else:
-                    mainID = ""
-            else:
-                modelID = ""
-                mainID = ""
             
             # Check if we have all parts
             if localID and modelID and mainID:
@@ -130,4 +185,4 @@ class PlateParser:
                 
         except Exception as e:
             logger.error(f"Error parsing license plate text: {str(e)}")
-            return None
\ No newline at end of file
+            return None
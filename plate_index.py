@@ -0,0 +1,106 @@
+import logging
+import threading
+
+from fuzzy_match import FuzzyPlateMatcher
+
+logger = logging.getLogger(__name__)
+
+
+class PlateIndex:
+    """
+    In-memory set of registered plates kept in sync with the plates table
+
+    Lookups are a set membership test and never touch the database. A
+    background thread polls the plates_version counter (bumped by triggers
+    whenever the web interface adds or removes a plate) and reloads the
+    set only when it changed.
+
+    Readings that are not registered exactly are looked up in a fuzzy
+    matcher that tolerates common OCR confusions (see fuzzy_match.py).
+    """
+
+    def __init__(self, db, poll_interval=1.0, max_edits=0, max_cost=0.6):
+        """
+        Initialize the index (call load() or start() before use)
+
+        Args:
+            db: db.Database instance
+            poll_interval: Seconds between version checks
+            max_edits: Non-look-alike edits the fuzzy matcher tolerates
+            max_cost: Confusion-weighted distance accepted for look-alike swaps
+        """
+        self.db = db
+        self.poll_interval = poll_interval
+        self.version = None
+        self._plates = frozenset()
+        self._matcher = FuzzyPlateMatcher(max_edits=max_edits, max_cost=max_cost)
+        self._matcher_lock = threading.Lock()
+        self._stop = threading.Event()
+        self._thread = None
+
+    def load(self):
+        """Reload all plates and remember the version they belong to"""
+        with self.db.connection() as conn:
+            # One read transaction so version and rows are consistent
+            with conn:
+                conn.execute("BEGIN")
+                version = conn.execute("SELECT version FROM plates_version WHERE id = 1").fetchone()[0]
+                plates = frozenset(row[0] for row in conn.execute("SELECT plate_number FROM plates"))
+        # Apply only the difference to the fuzzy matcher
+        with self._matcher_lock:
+            for plate in self._plates - plates:
+                self._matcher.remove(plate)
+            for plate in plates - self._plates:
+                self._matcher.add(plate)
+        # Swapping the reference is atomic, so readers never see a partial set
+        self._plates = plates
+        self.version = version
+        logger.info(f"Loaded {len(plates)} registered plates (version {version})")
+
+    def start(self):
+        """Load the plates and start watching for changes"""
+        self.load()
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._watch, name="plate-index")
+        self._thread.daemon = True
+        self._thread.start()
+
+    def stop(self):
+        """Stop watching for changes"""
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=2)
+            self._thread = None
+
+    def _watch(self):
+        """Reload the set whenever the version counter moves"""
+        while not self._stop.wait(self.poll_interval):
+            try:
+                row = self.db.fetchone("SELECT version FROM plates_version WHERE id = 1")
+                if row is not None and row[0] != self.version:
+                    self.load()
+            except Exception as e:
+                logger.error(f"Error refreshing plate index: {str(e)}")
+
+    def contains(self, plate_number):
+        """Check whether a plate is registered"""
+        return plate_number in self._plates
+
+    def match(self, plate_number):
+        """
+        Find the registered plate for an OCR reading
+
+        Args:
+            plate_number: Cleaned OCR plate text
+
+        Returns:
+            Tuple (registered_plate, score); score is 1.0 for an exact match
+            and (None, 0.0) when nothing registered is close enough
+        """
+        if plate_number in self._plates:
+            return plate_number, 1.0
+        with self._matcher_lock:
+            return self._matcher.best_match(plate_number)
+
+    def __len__(self):
+        return len(self._plates)
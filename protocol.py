@@ -0,0 +1,125 @@
+"""
+Smart Car Park System - STM32 UART protocol
+
+Packet format:
+| Start Byte (0xAA) | Length (1 byte) | Event ID (1 byte) | Data (n bytes) | CRC8 (1 byte) |
+
+Length counts the Event ID and Data bytes; the CRC8 (polynomial 0x07)
+covers the same bytes.
+"""
+
+import threading
+
+PACKET_START = 0xAA
+EVENT_DISPLAY = 0x01
+EVENT_SERVO = 0x02
+EVENT_CAR_DETECT = 0x03
+EVENT_LP_STATUS = 0x04
+EVENT_PARK_FULL = 0x05
+EVENT_ENTRY_DECISION = 0x06  # LP status + servo angle + display text in one packet
+
+MAX_DATA_LENGTH = 254  # Length byte covers Event ID + Data
+
+
+def _build_crc8_table(polynomial=0x07):
+    """Precompute the CRC8 of every single byte value"""
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            if crc & 0x80:
+                crc = ((crc << 1) ^ polynomial) & 0xFF
+            else:
+                crc = (crc << 1) & 0xFF
+        table.append(crc)
+    return bytes(table)
+
+
+CRC8_TABLE = _build_crc8_table()
+
+
+def crc8(data):
+    """Calculate CRC8 with polynomial 0x07 using the lookup table"""
+    crc = 0
+    table = CRC8_TABLE
+    for byte in data:
+        crc = table[crc ^ byte]
+    return crc
+
+
+class PacketEncoder:
+    """
+    Encodes outbound packets into a reusable buffer
+
+    Packets are cached by event and payload, so constant messages such as
+    "Welcome" or a servo angle are encoded once and returned as the same
+    bytes object afterwards. bytearray data is keyed by a bytes copy, so
+    the gate's bytearray([90]) hits the same entry as bytes([90]).
+    """
+
+    # Messages the gate sends all the time, encoded up front
+    COMMON_PACKETS = [
+        (EVENT_DISPLAY, "Welcome"),
+        (EVENT_DISPLAY, "Goodbye"),
+        (EVENT_DISPLAY, "Invalid Plate"),
+        (EVENT_DISPLAY, "Lot Full"),
+        (EVENT_DISPLAY, "No Plate Found"),
+        (EVENT_DISPLAY, "Please Wait"),
+        (EVENT_DISPLAY, "System starting"),
+        (EVENT_DISPLAY, "System Ready"),
+        (EVENT_SERVO, bytes([90])),
+        (EVENT_LP_STATUS, bytes([0])),
+        (EVENT_LP_STATUS, bytes([1])),
+        (EVENT_PARK_FULL, bytes([0])),
+        (EVENT_PARK_FULL, bytes([1])),
+    ]
+
+    def __init__(self, cache_size=128):
+        """
+        Initialize the encoder
+
+        Args:
+            cache_size: Maximum number of distinct packets kept in the cache
+        """
+        self.cache_size = cache_size
+        self._cache = {}
+        self._buffer = bytearray(MAX_DATA_LENGTH + 4)
+        self._lock = threading.Lock()
+        for event_id, data in self.COMMON_PACKETS:
+            self.encode(event_id, data)
+
+    def encode(self, event_id, data):
+        """
+        Encode a packet
+
+        Args:
+            event_id (int): Event ID
+            data (bytes, bytearray or str): Packet data
+
+        Returns:
+            bytes: Complete packet including start byte and CRC
+        """
+        key = (event_id, bytes(data) if isinstance(data, bytearray) else data)
+        packet = self._cache.get(key)
+        if packet is not None:
+            return packet
+
+        payload = data.encode('utf-8') if isinstance(data, str) else data
+        length = len(payload)
+        if length > MAX_DATA_LENGTH:
+            raise ValueError(f"Packet data too long ({length} bytes)")
+
+        with self._lock:
+            buffer = self._buffer
+            buffer[0] = PACKET_START
+            buffer[1] = length + 1
+            buffer[2] = event_id
+            buffer[3:3 + length] = payload
+            view = memoryview(buffer)
+            buffer[3 + length] = crc8(view[2:3 + length])
+            packet = bytes(view[:4 + length])
+            view.release()
+
+        if len(self._cache) < self.cache_size:
+            self._cache[key] = packet
+        return packet
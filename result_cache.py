@@ -0,0 +1,201 @@
+import logging
+import threading
+import time
+from collections import OrderedDict
+
+import cv2
+import numpy as np
+
+logger = logging.getLogger(__name__)
+
+
+def scene_hash(image, size=16):
+    """
+    Difference hash (dHash) of a frame
+
+    The frame is shrunk to size x (size + 1) grey pixels and every bit
+    says whether a pixel is brighter than its right neighbour, so small
+    shifts, noise and exposure changes flip only a few of the size * size
+    bits while a different scene flips many.
+
+    Args:
+        image: BGR or greyscale frame
+        size: Hash side length (the hash has size * size bits)
+
+    Returns:
+        int: The hash bits
+    """
+    gray = cv2.cvtColor(image, cv2.COLOR_BGR2GRAY) if image.ndim == 3 else image
+    small = cv2.resize(gray, (size + 1, size), interpolation=cv2.INTER_AREA)
+    bits = small[:, 1:] > small[:, :-1]
+    return int.from_bytes(np.packbits(bits).tobytes(), "big")
+
+
+def hamming(a, b):
+    """Number of differing bits between two hashes"""
+    return bin(a ^ b).count("1")
+
+
+def plate_region(image, box, margin=0.25):
+    """
+    Scene hash of the area around a plate box
+
+    Only the plate and a margin around it are hashed, so another car
+    stopping at the same spot flips many bits even though the barrier,
+    the road and the background around it look the same.
+
+    Args:
+        image: BGR or greyscale frame
+        box: (x1, y1, x2, y2) plate box in frame pixels, or None
+        margin: Fraction of the box size added on each side
+
+    Returns:
+        tuple: (region, hash) to compare later frames against with
+        region_distance(), or None without a box
+    """
+    if image is None or box is None:
+        return None
+    height, width = image.shape[:2]
+    x1, y1, x2, y2 = box
+    mx, my = int((x2 - x1) * margin), int((y2 - y1) * margin)
+    region = (max(0, x1 - mx), max(0, y1 - my), min(width, x2 + mx), min(height, y2 + my))
+    if region[2] - region[0] < 2 or region[3] - region[1] < 2:
+        return None
+    return region, scene_hash(image[region[1]:region[3], region[0]:region[2]])
+
+
+def region_distance(image, plate):
+    """
+    Hash distance between a frame and a plate_region() at the same place
+
+    Args:
+        image: BGR or greyscale frame from the same camera
+        plate: plate_region() result
+
+    Returns:
+        Number of differing hash bits (inf if the region is outside the frame)
+    """
+    (x1, y1, x2, y2), bits = plate
+    crop = image[y1:y2, x1:x2]
+    if crop.shape[0] < 2 or crop.shape[1] < 2:
+        return float("inf")
+    return hamming(scene_hash(crop), bits)
+
+
+class ResultCache:
+    """
+    Recent arrival decisions of one lane, for re-triggered sensors
+
+    A car inching forward makes the LM393 toggle and report a new arrival.
+    A decision is reused instead of recomputed when either:
+    - the area around the decided plate (plate_region() within
+      max_distance) looks the same, checked before detection and OCR run
+      at all; only decisions stored with scene_match, i.e. ones that keep
+      the barrier closed, are reused this way, or
+    - the burst reads a plate decided within the last ttl seconds.
+    Reused decisions are not logged again, so movement_log gets one row
+    per visit. A plate hit restarts the entry's ttl, so a car that keeps
+    toggling the sensor keeps hitting the cache; a scene hit does not,
+    so a lookalike scene can reuse a decision for at most ttl seconds.
+    """
+
+    def __init__(self, ttl=5.0, max_distance=24, max_entries=16):
+        """
+        Initialize the cache
+
+        Args:
+            ttl: Seconds a decision stays reusable after its last use
+            max_distance: Largest scene hash distance treated as the same scene
+            max_entries: Decisions kept (oldest are dropped first)
+        """
+        self.ttl = ttl
+        self.max_distance = max_distance
+        self.max_entries = max_entries
+        self._entries = OrderedDict()  # plate -> [plate region, packets, expires, scene_match]
+        self._lock = threading.Lock()
+        self.hits = 0
+        self.misses = 0
+
+    def _expire(self, now):
+        """Drop entries past their ttl (caller holds the lock)"""
+        for plate in [p for p, entry in self._entries.items() if entry[2] <= now]:
+            del self._entries[plate]
+
+    def _hit(self, plate, entry, now, region=None):
+        """Refresh an entry and return its decision (caller holds the lock)"""
+        if region is not None:
+            entry[0] = region
+        entry[2] = now + self.ttl
+        self._entries.move_to_end(plate)
+        self.hits += 1
+        return plate, list(entry[1])
+
+    def get_scene(self, image):
+        """
+        Find a barrier-closed decision whose plate area looks like this frame
+
+        Args:
+            image: Newest frame of the lane camera, or None
+
+        Returns:
+            tuple: (plate, packets), or None
+        """
+        if image is None:
+            return None
+        now = time.monotonic()
+        with self._lock:
+            self._expire(now)
+            best = None
+            for plate, entry in self._entries.items():
+                if entry[0] is None or not entry[3]:
+                    continue
+                distance = region_distance(image, entry[0])
+                if distance <= self.max_distance and (best is None or distance < best[0]):
+                    best = (distance, plate, entry)
+            if best is None:
+                self.misses += 1
+                return None
+            self.hits += 1
+            return best[1], list(best[2][1])
+
+    def get_plate(self, plate, region=None):
+        """
+        Find the decision made for a plate
+
+        Args:
+            plate: Plate number (registered spelling if matched)
+            region: plate_region() of the current frame, remembered on a hit
+
+        Returns:
+            tuple: (plate, packets), or None
+        """
+        now = time.monotonic()
+        with self._lock:
+            self._expire(now)
+            entry = self._entries.get(plate)
+            if entry is None:
+                return None
+            return self._hit(plate, entry, now, region)
+
+    def put(self, plate, region, packets, scene_match=True):
+        """
+        Remember a decision
+
+        Args:
+            plate: Plate number the decision is for
+            region: plate_region() of the frame it was made on, or None
+            packets: (event_id, data) packets that were sent
+            scene_match: Whether get_scene() may reuse it without reading
+                the plate; pass False for decisions that open the barrier
+        """
+        now = time.monotonic()
+        with self._lock:
+            self._entries[plate] = [region, list(packets), now + self.ttl, scene_match]
+            self._entries.move_to_end(plate)
+            while len(self._entries) > self.max_entries:
+                self._entries.popitem(last=False)
+
+    def clear(self):
+        """Forget every decision"""
+        with self._lock:
+            self._entries.clear()
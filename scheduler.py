@@ -0,0 +1,126 @@
+import logging
+import queue
+import threading
+import time
+from concurrent.futures import Future
+
+logger = logging.getLogger(__name__)
+
+
+class Overloaded(Exception):
+    """Raised by submit() when the scheduler already has max_pending requests"""
+
+
+class MicroBatchScheduler:
+    """
+    Groups concurrent requests into small batches for a batched model call
+
+    Requests wait on a bounded queue. A worker takes the oldest one, then
+    keeps collecting until it has max_batch requests or max_wait seconds
+    have passed, and hands the whole group to process_batch in one call.
+    Alone, a request waits at most max_wait extra; under load, the call
+    overhead is paid once per batch instead of once per image. When the
+    queue is full, submit() raises Overloaded at once instead of letting
+    latency grow without bound.
+    """
+
+    def __init__(self, process_batch, max_batch=4, max_wait=0.01, max_pending=16, workers=1, name="batch"):
+        """
+        Initialize the scheduler (start() launches the workers)
+
+        Args:
+            process_batch: Callable taking a list of items and returning a
+                list of results in the same order
+            max_batch: Largest number of items per call
+            max_wait: Seconds a batch waits to fill up after its first item
+            max_pending: Items queued before submit() refuses
+            workers: Worker threads calling process_batch
+            name: Thread name prefix
+        """
+        self.process_batch = process_batch
+        self.max_batch = max_batch
+        self.max_wait = max_wait
+        self.workers = workers
+        self.name = name
+        self.pending = queue.Queue(maxsize=max_pending)
+        self.running = False
+        self.batches = 0
+        self.items = 0
+        self.rejected = 0
+        self._threads = []
+
+    def start(self):
+        """Start the worker threads"""
+        if self.running:
+            return
+        self.running = True
+        for i in range(self.workers):
+            thread = threading.Thread(target=self._worker, name=f"{self.name}-{i}")
+            thread.daemon = True
+            thread.start()
+            self._threads.append(thread)
+
+    def stop(self):
+        """Stop the workers after their current batch"""
+        self.running = False
+        for thread in self._threads:
+            thread.join(timeout=5)
+        self._threads = []
+
+    def submit(self, item):
+        """
+        Queue an item without blocking
+
+        Returns:
+            concurrent.futures.Future resolving to the item's result
+
+        Raises:
+            Overloaded: If max_pending items are already waiting
+        """
+        future = Future()
+        try:
+            self.pending.put_nowait((item, future))
+        except queue.Full:
+            self.rejected += 1
+            raise Overloaded(f"{self.name} queue full")
+        return future
+
+    def _collect(self):
+        """Wait for a first item, then gather up to max_batch within max_wait"""
+        try:
+            batch = [self.pending.get(timeout=0.5)]
+        except queue.Empty:
+            return []
+        deadline = time.monotonic() + self.max_wait
+        while len(batch) < self.max_batch:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            try:
+                batch.append(self.pending.get(timeout=remaining))
+            except queue.Empty:
+                break
+        return batch
+
+    def _worker(self):
+        """Worker loop: run batches and resolve their futures"""
+        while self.running:
+            batch = self._collect()
+            if not batch:
+                continue
+            # Requests whose caller went away are not worth computing
+            batch = [(item, future) for item, future in batch if future.set_running_or_notify_cancel()]
+            if not batch:
+                continue
+            try:
+                results = self.process_batch([item for item, _ in batch])
+                if len(results) != len(batch):
+                    raise RuntimeError(f"process_batch returned {len(results)} results for {len(batch)} items")
+                for (_, future), result in zip(batch, results):
+                    future.set_result(result)
+            except Exception as e:
+                logger.error(f"Error in {self.name} batch: {str(e)}")
+                for _, future in batch:
+                    future.set_exception(e)
+            self.batches += 1
+            self.items += len(batch)
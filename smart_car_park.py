@@ -6,20 +6,42 @@ Manages:
 - UART communication with STM32
 - License plate recognition via USB webcam
 - SQLite database for registered plates
-- Parking lot capacity tracking
+- Parking lot occupancy tracking (entry and exit lanes)
 """
 
 import serial
 import cv2
-import sqlite3
 import threading
+import queue
+import itertools
+from collections import deque
 import time
 import logging
 import os
+import json
 import numpy as np
 from datetime import datetime
 from detector import LicensePlateDetector
 from ocr_reader import OCRReader
+from camera import CameraCapture
+from burst import BurstRecognizer
+from workers import RecognitionPool
+from db import Database
+from plate_index import PlateIndex
+from log_writer import MovementLogWriter
+from archive import MovementArchive
+from occupancy import OccupancyTracker
+from result_cache import ResultCache, plate_region, region_distance
+from motion import MotionDetector
+from debug_sink import DebugImageSink
+from model_loader import ModelLoader, warm_up
+from inference_server import InferenceClient
+from metrics import MetricsServer, STAGE_SECONDS, UART_CRC_ERRORS, UART_RETRIES, PRE_RECOGNITIONS
+from protocol import (
+    PACKET_START, EVENT_DISPLAY, EVENT_SERVO, EVENT_CAR_DETECT,
+    EVENT_LP_STATUS, EVENT_PARK_FULL, EVENT_ENTRY_DECISION,
+    PacketEncoder, crc8
+)
 
 # Configure logging
 logging.basicConfig(
@@ -31,35 +53,256 @@ logging.basicConfig(
     ]
 )
 
-# Global constants
-PACKET_START = 0xAA
-EVENT_DISPLAY = 0x01
-EVENT_SERVO = 0x02
-EVENT_CAR_DETECT = 0x03
-EVENT_LP_STATUS = 0x04
-EVENT_PARK_FULL = 0x05
+# UART receiver settings
+UART_READ_TIMEOUT = 0.5  # seconds; only bounds how long a disconnect goes unnoticed
+MAX_LINE_LENGTH = 16     # longest OK/ERR text kept while waiting for a newline
+
+# UART sender settings
+OUTBOUND_QUEUE_SIZE = 32
+MAX_IN_FLIGHT = 3       # packets written before their OK/ERR arrives
+ACK_TIMEOUT = 0.3       # seconds to wait for the oldest in-flight packet
+MAX_SEND_RETRIES = 3
+USE_ENTRY_DECISION_PACKET = False  # needs STM32 firmware support for EVENT_ENTRY_DECISION
+
+# Lower values are sent first
+PACKET_PRIORITY = {
+    EVENT_SERVO: 0,
+    EVENT_ENTRY_DECISION: 0,
+    EVENT_LP_STATUS: 1,
+    EVENT_PARK_FULL: 1,
+    EVENT_DISPLAY: 2
+}
 
 # Global variables
-car_detected = False
-lot_capacity = 0
 MAX_CAPACITY = 100
-lock = threading.Lock()
+# Direction of the default single lane: "entry" lets registered cars in, "exit" lets them out
+GATE_DIRECTION = os.environ.get("GATE_DIRECTION", "entry")
 db_path = "car_park.db"
+db = Database(db_path)
+# Fuzzy plate matching: look-alike swaps (0/O/D, 8/B, 5/S, ...) cost 0.3, other edits 1
+FUZZY_MAX_EDITS = 0    # edits other than look-alike swaps that are tolerated, each on top of FUZZY_MAX_COST
+FUZZY_MAX_COST = 0.6   # i.e. at most two look-alike swaps
+plate_index = PlateIndex(db, max_edits=FUZZY_MAX_EDITS, max_cost=FUZZY_MAX_COST)  # started in main()
+log_writer = MovementLogWriter(db, spool_path="movement_log.spool")  # started in main()
+# Movement log retention: whole months older than this move to archive/*.db
+LOG_RETENTION_DAYS = 90
+log_archive = MovementArchive(db, archive_dir="archive", retention_days=LOG_RETENTION_DAYS)  # started in main()
+# Other gate processes fill or free spaces too; every lane's display follows
+occupancy = OccupancyTracker(
+    db,
+    capacity=MAX_CAPACITY,
+    on_full=lambda full: broadcast_packet(EVENT_PARK_FULL, bytes([1 if full else 0]))
+)  # started in main()
+
+# Camera settings
+CAMERA_INDEX = 0
+CAMERA_WIDTH = 1280
+CAMERA_HEIGHT = 720
+CAMERA_BUFFER_SIZE = 8
+MAX_FRAME_AGE = 0.5  # seconds; older frames mean the camera has stalled
+
+# Detector backend: "torch" (best.pt), or an exported "onnx", "openvino" or "ncnn" model
+DETECTOR_BACKEND = os.environ.get("DETECTOR_BACKEND", "torch")
+DETECTOR_MODEL = os.environ.get("DETECTOR_MODEL")  # None uses the backend default path
+DETECTOR_ROI = None   # static (x1, y1, x2, y2) plate search region as frame fractions
+ADAPTIVE_ROI = True   # learn the search region from recent plate boxes
+
+# OCR engine: "rec" reads YOLO crops with recognition only, "det_rec" runs full PaddleOCR
+OCR_ENGINE = "rec"
+
+# Burst recognition settings
+BURST_SIZE = 4           # frames taken from the ring buffer per arrival
+BURST_CONSENSUS = 0.6    # share of vote weight the winning plate needs
+BURST_MIN_SUPPORT = 0.9  # summed confidence of agreeing reads to stop early
+
+# Re-triggered arrivals (a car inching forward) reuse the recent decision
+RESULT_CACHE_TTL = 5.0        # seconds a decision stays reusable after its last use
+SCENE_HASH_MAX_DISTANCE = 24  # of 256 dHash bits around the plate; more means a different car
+
+# Pre-recognition: motion in downscaled frames starts detection + OCR while the car approaches,
+# before the LM393 fires. The arrival uses the latest reading only if its own newest frame still
+# shows the same plate area; an arrival at any lane cancels a reading that is still running.
+PRE_RECOGNITION = os.environ.get("PRE_RECOGNITION", "true").lower() == "true"
+PRE_RECOGNITION_MAX_AGE = 3.0   # seconds a speculative reading stays usable
+PRE_RECOGNITION_PRIORITY = 10   # added to the lane priority: queued behind every real arrival
+
+# Recognition worker pool (one worker: the detector and OCR models are not shared between threads)
+RECOGNITION_WORKERS = 1
+MAX_PENDING_ARRIVALS = 4
+
+# Debug images, written in the background: "all", "failures" (no plate read) or "off"
+DEBUG_IMAGE_MODE = os.environ.get("DEBUG_IMAGE_MODE", "failures")
+DEBUG_IMAGE_EVERY_N = 1                   # keep one in N sampled arrivals
+DEBUG_IMAGE_MAX_BYTES = 200 * 1024 * 1024  # oldest images are deleted beyond this
+DEBUG_IMAGE_QUEUE_SIZE = 8                # images beyond this are dropped, never waited for
+# DEBUG_IMAGES=true also saves every detection with its box drawn
+DEBUG_DETECTIONS = os.environ.get("DEBUG_IMAGES", "false").lower() == "true"
+
+debug_sink = DebugImageSink(
+    directory="debug_images",
+    mode=DEBUG_IMAGE_MODE,
+    every_n=DEBUG_IMAGE_EVERY_N,
+    max_bytes=DEBUG_IMAGE_MAX_BYTES,
+    max_queue=DEBUG_IMAGE_QUEUE_SIZE
+)  # started in main()
+
+# Sample image from test_img/ run through both models before the first car
+WARMUP_DIR = "test_img"
+
+# Socket of a shared inference server (see inference_server.py); unset loads the models here
+INFERENCE_SOCKET = os.environ.get("INFERENCE_SOCKET")
+INFERENCE_READY_TIMEOUT = 300  # seconds to wait for the server's models at startup
+
+# Prometheus metrics (stage latencies, detection misses, CRC errors) on http://<pi>:METRICS_PORT/metrics; 0 disables
+METRICS_PORT = int(os.environ.get("METRICS_PORT", "9100"))
+metrics_server = MetricsServer(port=METRICS_PORT)  # started in main()
+
+def build_detector():
+    """Load the license plate detector"""
+    return LicensePlateDetector(
+        model_path=DETECTOR_MODEL,
+        backend=DETECTOR_BACKEND,
+        roi=DETECTOR_ROI,
+        adaptive_roi=ADAPTIVE_ROI,
+        debug_sink=debug_sink if DEBUG_DETECTIONS else None
+    )
+
+def build_ocr():
+    """Load the OCR reader"""
+    return OCRReader(engine=OCR_ENGINE)
+
+def build_inference_client():
+    """Connect to the shared inference server and wait until its models are ready"""
+    client = InferenceClient(
+        INFERENCE_SOCKET,
+        frame_capacity=BURST_SIZE * CAMERA_WIDTH * CAMERA_HEIGHT * 3,
+        consensus=BURST_CONSENSUS,
+        min_support=BURST_MIN_SUPPORT
+    )
+    return client.wait_ready(timeout=INFERENCE_READY_TIMEOUT)
+
+# Detector, OCR reader and burst recognizer, set once the models are loaded
+detector = None
+ocr = None
+recognizer = None
+
+def install_models(models):
+    """Wire the loaded models into the recognition pipeline"""
+    global detector, ocr, recognizer
+    if "inference" in models:
+        # The server runs detection and OCR; the client has the same recognize()
+        recognizer = models["inference"]
+        return
+    detector = models["detector"]
+    ocr = models["ocr"]
+    recognizer = BurstRecognizer(
+        detector,
+        ocr,
+        consensus=BURST_CONSENSUS,
+        min_support=BURST_MIN_SUPPORT
+    )
+
+# Models load in parallel in the background, started in main(), while the UART is already served
+if INFERENCE_SOCKET:
+    models = ModelLoader({"inference": build_inference_client})
+else:
+    models = ModelLoader(
+        {"detector": build_detector, "ocr": build_ocr},
+        warmup=lambda loaded: warm_up(loaded["detector"], loaded["ocr"], WARMUP_DIR)
+    )
+models.on_ready(install_models)
+
+# Arrival jobs run here instead of on the UART receiver thread, started in main()
+recognition_pool = RecognitionPool(
+    workers=RECOGNITION_WORKERS,
+    max_pending=MAX_PENDING_ARRIVALS
+)
+
+# Lanes served by this gate, each with its own camera and STM32 link; all of them share
+# the models and the recognition pool. Lower priority values are recognized first, so
+# by default a car leaving (which frees a space) goes before one arriving.
+# GATE_LANES takes the same list as JSON, e.g.
+# [{"name": "entry-1", "direction": "entry", "port": "/dev/ttyUSB0", "camera": 0},
+#  {"name": "exit-1", "direction": "exit", "port": "/dev/ttyUSB1", "camera": 2}]
+LANE_PRIORITY = {"exit": 0, "entry": 1}
+LANES = [
+    {"name": GATE_DIRECTION, "direction": GATE_DIRECTION, "port": "/dev/serial0", "camera": CAMERA_INDEX},
+]
+if os.environ.get("GATE_LANES"):
+    LANES = json.loads(os.environ["GATE_LANES"])
+
+# Running lanes, filled in main()
+lanes = []
 
-# Initialize license plate detector and OCR reader
-detector = LicensePlateDetector(model_path="best.pt")
-ocr = OCRReader()
+def broadcast_packet(event_id, data, exclude=None):
+    """Send a packet to the STM32 of every running lane
+    
+    Args:
+        event_id (int): Event ID
+        data: Packet data
+        exclude (UARTHandler): Lane link that already sends it itself
+    """
+    for lane in lanes:
+        if lane.uart is not exclude:
+            lane.uart.send_packet(event_id, data)
+
+def cancel_speculation(arrival):
+    """Stop the speculative reads of every lane so an arrival gets the worker
+    
+    Args:
+        arrival (UARTHandler): Lane link where the car arrived
+    """
+    arrival.speculation_cancel.set()
+    for lane in lanes:
+        lane.uart.speculation_cancel.set()
 
 class UARTHandler:
     """Handles UART communication with STM32"""
     
-    def __init__(self, port="/dev/serial0", baud_rate=115200):
-        """Initialize UART communication"""
+    def __init__(self, port="/dev/serial0", baud_rate=115200, direction="entry", camera=None, priority=None, name=None):
+        """Initialize UART communication
+        
+        Args:
+            port (str): Serial device of the lane's STM32
+            baud_rate (int): UART baud rate
+            direction (str): 'entry' or 'exit' lane
+            camera (CameraCapture): The lane's camera
+            priority (int): Recognition priority, lower first (default from LANE_PRIORITY)
+            name (str): Lane name used in logs
+        """
+        if direction not in ("entry", "exit"):
+            raise ValueError(f"Unknown lane direction: {direction}")
         self.port = port
         self.baud_rate = baud_rate
+        self.direction = direction
+        self.camera = camera
+        self.priority = LANE_PRIORITY[direction] if priority is None else priority
+        self.name = name or direction
+        self.car_detected = False
+        
+        # Motion-triggered reading: (plate, plate region, time read), taken by the next arrival
+        self.speculation = None
+        self.speculating = False
+        self.speculation_again = False  # the car settled during a read: read the still scene next
+        self.speculation_lock = threading.Lock()
+        self.speculation_cancel = threading.Event()
         self.ser = None
         self.running = False
-        self.buffer = bytearray()
+        self.line_buffer = bytearray()  # Partial OK/ERR line between packets
+        # The sender and receiver threads both write (packets and OK/ERR)
+        self.write_lock = threading.Lock()
+        # Outbound packets waiting to be written, ordered by (priority, seq)
+        self.outbound = queue.PriorityQueue()
+        self.sequence = itertools.count()
+        # Written packets awaiting OK/ERR; the STM32 answers in order, untagged
+        self.in_flight = deque()
+        self.ack_cond = threading.Condition()
+        # After an ACK timeout: late replies to the timed-out writes are dropped until
+        # discard_until, then packets go out one at a time until the next OK
+        self.window = MAX_IN_FLIGHT
+        self.discard_until = 0.0
+        self.encoder = PacketEncoder()
+        self.result_cache = ResultCache(ttl=RESULT_CACHE_TTL, max_distance=SCENE_HASH_MAX_DISTANCE)
     
     def connect(self):
         """Connect to UART port"""
@@ -70,7 +313,7 @@ class UARTHandler:
                 bytesize=serial.EIGHTBITS,
                 parity=serial.PARITY_NONE,
                 stopbits=serial.STOPBITS_ONE,
-                timeout=0.1
+                timeout=UART_READ_TIMEOUT
             )
             self.running = True
             logging.info(f"Connected to {self.port} at {self.baud_rate} baud")
@@ -87,59 +330,136 @@ class UARTHandler:
             logging.info(f"Disconnected from {self.port}")
     
     def send_packet(self, event_id, data):
-        """Send a packet to STM32
+        """Queue a packet for the STM32 without waiting for its ACK
         
         Args:
-            event_id (int): Event ID (0x01-0x05)
-            data (bytes or bytearray): Data to send
+            event_id (int): Event ID (0x01-0x06)
+            data (bytes or bytearray or str): Data to send
         
         Returns:
-            bool: True if packet was sent successfully
+            bool: True if the packet was queued
         """
         if not self.ser or not self.ser.is_open:
             logging.error("Cannot send packet: UART not connected")
             return False
         
-        # Construct packet
-        packet = bytearray([PACKET_START])
-        packet.append(len(data) + 1)  # Length (event ID + data)
-        packet.append(event_id)       # Event ID
+        if self.outbound.qsize() >= OUTBOUND_QUEUE_SIZE:
+            logging.error(f"Outbound queue full, dropping event {event_id:#04x}")
+            return False
         
-        # Add data
-        if isinstance(data, (bytes, bytearray)):
-            packet.extend(data)
-        else:
-            packet.extend(data.encode('utf-8'))
+        # Construct packet (constant messages come straight from the cache)
+        try:
+            packet = self.encoder.encode(event_id, data)
+        except ValueError as e:
+            logging.error(f"Cannot send packet: {str(e)}")
+            return False
         
-        # Calculate CRC8
-        crc = self.calculate_crc8(packet[2:])
-        packet.append(crc)
+        priority = PACKET_PRIORITY.get(event_id, 2)
+        self.outbound.put((priority, next(self.sequence), packet, 0))
+        return True
+    
+    def send_packets(self, packets):
+        """Queue a list of (event_id, data) packets"""
+        for event_id, data in packets or []:
+            self.send_packet(event_id, data)
+    
+    def sender_thread(self):
+        """Thread that writes queued packets, keeping up to MAX_IN_FLIGHT unacknowledged"""
         
-        try:
-            self.ser.write(packet)
-            logging.debug(f"Sent packet: {packet.hex()}")
+        while self.running:
+            with self.ack_cond:
+                # The oldest packet timed out: no reply came for anything in flight
+                if self.in_flight and time.time() - self.in_flight[0][4] > ACK_TIMEOUT:
+                    self._recover()
+                
+                # Wait out late replies to the timed-out writes before writing again
+                quiet = self.discard_until - time.time()
+                if quiet > 0:
+                    self.ack_cond.wait(quiet)
+                    continue
+                
+                if len(self.in_flight) >= self.window:
+                    self.ack_cond.wait(ACK_TIMEOUT)
+                    continue
+                
+                # Wake up in time to check the oldest packet's ACK deadline
+                wait = ACK_TIMEOUT if self.in_flight else 0.5
+            
+            try:
+                priority, seq, packet, retries = self.outbound.get(timeout=wait)
+            except queue.Empty:
+                continue
             
-            # Wait for response
-            response = self.ser.readline().decode('utf-8').strip()
+            try:
+                with self.ack_cond:
+                    self.in_flight.append((priority, seq, packet, retries, time.time()))
+                with self.write_lock:
+                    self.ser.write(packet)
+                logging.debug(f"Sent packet: {packet.hex()}")
+            except Exception as e:
+                logging.error(f"Error sending packet: {str(e)}")
+                time.sleep(0.1)
+    
+    def _recover(self):
+        """Requeue everything in flight after an ACK timeout (caller holds ack_cond)
+        
+        Replies are matched by order only, so a late OK for a timed-out
+        write would otherwise be credited to its retransmitted copy and
+        shift every later match. Replies arriving within ACK_TIMEOUT are
+        dropped as late, and the packets are resent one at a time (the
+        head first) until an OK shows the link is in step again. Only the
+        head counts as a retry; the rest were never answered either way.
+        """
+        logging.warning(f"ACK timeout, resending {len(self.in_flight)} in-flight packet(s) one at a time")
+        UART_RETRIES.inc(lane=self.name, reason="timeout")
+        self._retry(self.in_flight.popleft(), "timeout")
+        while self.in_flight:
+            priority, seq, packet, retries, _ = self.in_flight.popleft()
+            self.outbound.put((priority, seq, packet, retries))
+        self.window = 1
+        self.discard_until = time.time() + ACK_TIMEOUT
+    
+    def _retry(self, entry, reason):
+        """Requeue an in-flight packet (caller holds ack_cond)"""
+        priority, seq, packet, retries, _ = entry
+        if retries >= MAX_SEND_RETRIES:
+            logging.error(f"Giving up on packet {packet.hex()} after {retries + 1} attempts ({reason})")
+            return
+        logging.warning(f"Retrying packet {packet.hex()} ({reason})")
+        # Same (priority, seq) keeps it ahead of packets queued after it
+        self.outbound.put((priority, seq, packet, retries + 1))
+    
+    def handle_ack(self, response):
+        """Match an OK/ERR line from the STM32 to the oldest in-flight packet"""
+        with self.ack_cond:
+            if time.time() < self.discard_until:
+                logging.warning(f"Dropping late response {response} to a timed-out packet")
+                return
+            if not self.in_flight:
+                logging.warning(f"Unexpected response: {response}")
+                return
+            entry = self.in_flight.popleft()
             if response == "OK":
                 logging.debug("Received OK response")
-                return True
+                STAGE_SECONDS.observe(time.time() - entry[4], stage="uart_ack")
+                self.window = MAX_IN_FLIGHT
             elif response == "ERR":
-                logging.warning("Received ERR response")
-                return False
+                UART_RETRIES.inc(lane=self.name, reason="err")
+                self._retry(entry, "ERR")
             else:
-                logging.warning(f"Unknown response: {response}")
-                return False
-        except Exception as e:
-            logging.error(f"Error sending packet: {str(e)}")
-            return False
+                UART_RETRIES.inc(lane=self.name, reason="unknown")
+                self._retry(entry, f"unknown response {response!r}")
+            self.ack_cond.notify_all()
     
     def receiver_thread(self):
-        """Thread that receives and processes incoming packets"""
+        """Thread that receives and processes incoming packets
         
-        packet_state = 0  # 0: waiting for start, 1: got length, 2: collecting data
-        packet_length = 0
-        packet_data = bytearray()
+        Blocks in the serial read until bytes arrive (the read timeout only
+        lets it notice a disconnect), then slices whole packets out of the
+        receive buffer in bulk.
+        """
+        
+        buffer = bytearray()
         
         while self.running:
             if not self.ser or not self.ser.is_open:
@@ -147,42 +467,81 @@ class UARTHandler:
                 continue
             
             try:
-                # Read available data
-                if self.ser.in_waiting > 0:
-                    data = self.ser.read(self.ser.in_waiting)
-                    
-                    for byte in data:
-                        # State machine to parse incoming packets
-                        if packet_state == 0:  # Waiting for start byte
-                            if byte == PACKET_START:
-                                packet_data = bytearray([PACKET_START])
-                                packet_state = 1
-                        
-                        elif packet_state == 1:  # Got start, get length
-                            packet_length = byte
-                            packet_data.append(byte)
-                            packet_state = 2
-                        
-                        elif packet_state == 2:  # Collecting data
-                            packet_data.append(byte)
-                            
-                            # Check if we have a complete packet
-                            if len(packet_data) >= packet_length + 3:  # Start + Length + Data + CRC
-                                self.process_packet(packet_data)
-                                packet_state = 0  # Reset state machine
-                    
-                time.sleep(0.01)  # Small delay to prevent CPU hogging
+                # Wait for the first byte, then take whatever else has arrived
+                data = self.ser.read(1)
+                if not data:
+                    continue
+                waiting = self.ser.in_waiting
+                if waiting:
+                    data += self.ser.read(waiting)
+                
+                buffer += data
+                consumed = self.parse_buffer(buffer)
+                del buffer[:consumed]
             
             except Exception as e:
                 logging.error(f"Error in receiver thread: {str(e)}")
+                buffer = bytearray()
                 time.sleep(1)
     
+    def parse_buffer(self, buffer):
+        """Dispatch every complete packet and OK/ERR line in buffer
+        
+        Args:
+            buffer (bytearray): Received bytes, oldest first
+        
+        Returns:
+            int: Number of bytes consumed from the front of buffer
+        """
+        pos = 0
+        end = len(buffer)
+        
+        while pos < end:
+            start = buffer.find(PACKET_START, pos)
+            
+            # Anything before the next start byte is OK/ERR text
+            text_end = end if start < 0 else start
+            if text_end > pos:
+                self.handle_text(buffer[pos:text_end])
+                pos = text_end
+            if start < 0:
+                break
+            
+            # Start + Length + Data + CRC, where Length covers Event ID + Data
+            if end - start < 2:
+                break
+            packet_end = start + buffer[start + 1] + 3
+            if packet_end > end:
+                break
+            
+            self.process_packet(bytes(buffer[start:packet_end]))
+            pos = packet_end
+        
+        return pos
+    
+    def handle_text(self, text):
+        """Collect OK/ERR text and pass each complete line to handle_ack"""
+        self.line_buffer += text
+        if b"\n" not in self.line_buffer:
+            # Drop noise that never forms a line
+            if len(self.line_buffer) > MAX_LINE_LENGTH:
+                self.line_buffer = bytearray()
+            return
+        
+        *lines, rest = self.line_buffer.split(b"\n")
+        self.line_buffer = bytearray(rest)
+        for line in lines:
+            response = line.decode('utf-8', 'replace').strip()
+            if response:
+                self.handle_ack(response)
+    
     def process_packet(self, packet):
         """Process a complete packet from STM32"""
         
         # Verify packet format
         if len(packet) < 4:  # Minimum: Start + Length + Event ID + CRC
             logging.error(f"Invalid packet length: {len(packet)}")
+            UART_CRC_ERRORS.inc(lane=self.name)
             self.send_response("ERR")
             return
         
@@ -197,6 +556,7 @@ class UARTHandler:
         # Verify CRC
         if received_crc != calculated_crc:
             logging.error(f"CRC mismatch: received {received_crc}, calculated {calculated_crc}")
+            UART_CRC_ERRORS.inc(lane=self.name)
             self.send_response("ERR")
             return
         
@@ -205,14 +565,15 @@ class UARTHandler:
         
         # Process based on event ID
         if event_id == EVENT_CAR_DETECT:
-            global car_detected
             is_detected = data[0] == 1
             
             # Only process state changes
-            if is_detected != car_detected:
-                car_detected = is_detected
-                if car_detected:
-                    logging.info("Car detected")
+            if is_detected != self.car_detected:
+                self.car_detected = is_detected
+                if self.car_detected:
+                    logging.info(f"Car detected at lane {self.name}")
+                    # Free the worker for the arrival instead of finishing a speculative read
+                    cancel_speculation(self)
                     self.handle_car_arrival()
                 else:
                     logging.info("No car")
@@ -222,203 +583,428 @@ class UARTHandler:
     def send_response(self, response):
         """Send a simple text response (OK/ERR)"""
         if self.ser and self.ser.is_open:
-            self.ser.write(f"{response}\n".encode())
+            with self.write_lock:
+                self.ser.write(f"{response}\n".encode())
     
     def handle_car_arrival(self):
-        """Handle a car arriving at the barrier"""
+        """Queue recognition for a car arriving at the barrier
         
-        # Check if lot is full
-        global lot_capacity, MAX_CAPACITY
-        if lot_capacity >= MAX_CAPACITY:
-            logging.info("Parking lot is full")
-            self.send_packet(EVENT_PARK_FULL, bytearray([1]))
-            self.send_packet(EVENT_DISPLAY, "Lot Full")
+        Runs on the receiver thread, so it only enqueues the job; the
+        resulting packets go to the outbound queue via send_packets.
+        """
+        arrived = time.perf_counter()
+        
+        def respond(packets):
+            # Sensor report to queued answer, including the wait for a worker
+            STAGE_SECONDS.observe(time.perf_counter() - arrived, stage="arrival")
+            self.send_packets(packets)
+        
+        if not recognition_pool.submit(self.decide_car_arrival, respond, priority=self.priority):
+            self.send_packet(EVENT_DISPLAY, "Please Wait")
+    
+    def decide_car_arrival(self):
+        """Recognize the arriving car and decide what to tell the STM32
+        
+        Returns:
+            list: (event_id, data) packets to send, in order
+        """
+        
+        # Still loading after a restart: tell the driver instead of leaving the barrier silent
+        if not models.is_ready():
+            logging.warning("Car arrived while the recognition models are still loading")
+            return [(EVENT_DISPLAY, "System starting")]
+        
+        # Take the freshest frames from the running capture thread
+        with STAGE_SECONDS.time(stage="camera"):
+            frames = self.camera.burst(BURST_SIZE, max_age=MAX_FRAME_AGE)
+        if not frames:
+            logging.error(f"No fresh frame available from the camera of lane {self.name}")
+        
+        # Same plate area as a recent refusal: the sensor re-triggered, skip detection and OCR
+        cached = self.result_cache.get_scene(frames[0] if frames else None)
+        if cached is not None:
+            logging.info(f"Scene unchanged, reusing decision for plate {cached[0]}")
+            return cached[1]
+        
+        if self.direction == "exit":
+            return self.decide_exit(frames)
+        return self.decide_entry(frames)
+    
+    def on_motion(self, event):
+        """Queue a speculative plate read while a car approaches the lane camera
+        
+        Runs on the motion detector thread. Any event queues a read, so
+        the plate is usually read before the car reaches the sensor; at
+        most one runs per lane, and a car settling while it runs queues
+        one more read of the still scene. Each reading replaces the
+        previous one. Nothing is queued while a car is already at the
+        sensor (its arrival reads the plate), while the models load or
+        while other jobs wait for a worker.
+        
+        Args:
+            event (str): 'start', 'moving' or 'settled'
+        """
+        if self.car_detected or not models.is_ready() or recognition_pool.pending():
             return
+        with self.speculation_lock:
+            if self.speculating:
+                self.speculation_again = self.speculation_again or event == "settled"
+                return
+            self.speculating = True
+        self.speculation_cancel.clear()
+        logging.debug(f"Motion ({event}) at lane {self.name}, reading plate ahead of the sensor")
+        if not recognition_pool.submit(self.pre_recognize, priority=self.priority + PRE_RECOGNITION_PRIORITY):
+            self.speculating = False
+    
+    def pre_recognize(self):
+        """Read the plate of a car before it reaches the sensor
+        
+        The reading is only remembered; nothing is logged or sent, since
+        the car may never stop at this barrier. It does not feed the
+        detector's adaptive ROI, and stops early once an arrival at any
+        lane sets speculation_cancel.
+        """
+        try:
+            # The car reached the sensor meanwhile: its own arrival reads the plate
+            if self.car_detected or self.speculation_cancel.is_set():
+                return
+            frames = self.camera.burst(BURST_SIZE, max_age=MAX_FRAME_AGE)
+            if not frames:
+                return
+            with STAGE_SECONDS.time(stage="pre_recognition"):
+                result = recognizer.recognize(frames, camera=self.name, remember=False, cancel=self.speculation_cancel)
+            if result is not None:
+                logging.info(f"Pre-read plate {result['plate']} at lane {self.name}")
+                self.speculation = (result["plate"], plate_region(frames[0], result["box"]), time.monotonic())
+        except Exception as e:
+            logging.error(f"Error in pre-recognition: {str(e)}")
+        finally:
+            with self.speculation_lock:
+                self.speculating = False
+                again, self.speculation_again = self.speculation_again, False
+            if again and not self.speculation_cancel.is_set():
+                self.on_motion("settled")
+    
+    def read_plate(self, frames):
+        """Plate of the arriving car
+        
+        Uses the motion-triggered reading if it is recent and the area
+        around the plate it read looks the same in the arrival's newest
+        frame, i.e. the car it read is the one at the barrier; otherwise
+        it is discarded and the burst is recognized now.
         
-        # Capture license plate
-        plate_number = capture_license_plate()
+        Args:
+            frames (list): Burst of recent frames, newest first
+        
+        Returns:
+            tuple: (plate number or None, plate_region() of the newest frame or None)
+        """
+        speculation, self.speculation = self.speculation, None
+        if speculation is not None:
+            plate, region, read_at = speculation
+            if time.monotonic() - read_at > PRE_RECOGNITION_MAX_AGE:
+                PRE_RECOGNITIONS.inc(lane=self.name, outcome="stale")
+            elif region is None or not frames or region_distance(frames[0], region) > SCENE_HASH_MAX_DISTANCE:
+                logging.info(f"Discarding pre-read plate {plate}: the plate area at the barrier has changed")
+                PRE_RECOGNITIONS.inc(lane=self.name, outcome="mismatch")
+            else:
+                logging.info(f"Using pre-read plate {plate}")
+                PRE_RECOGNITIONS.inc(lane=self.name, outcome="used")
+                return plate, region
+        plate, box = capture_license_plate(frames, camera=self.name)
+        return plate, plate_region(frames[0], box) if plate else None
+    
+    def decide_entry(self, frames):
+        """Decide whether a car at the entry barrier may enter
+        
+        Args:
+            frames (list): Burst of recent frames, newest first
+        
+        Returns:
+            list: (event_id, data) packets to send, in order
+        """
+        
+        packets = []
+        
+        # Capture license plate (or take the reading made while it approached)
+        plate_number, region = self.read_plate(frames)
         if plate_number:
             logging.info(f"Detected plate: {plate_number}")
             
-            # Check if plate is registered
-            if check_plate_registered(plate_number):
+            # Check if plate is registered, tolerating OCR look-alike errors
+            registered_plate = find_registered_plate(plate_number)
+            
+            # Decided moments ago: do not take a second space or log a second entry
+            cached = self.result_cache.get_plate(registered_plate or plate_number, region)
+            if cached is not None:
+                logging.info(f"Plate {cached[0]} decided moments ago, reusing decision")
+                return cached[1]
+            
+            # Full lot: refuse new plates (checked again when the space is taken); a car
+            # already inside, e.g. the one that took the last space, keeps its space
+            if occupancy.is_full() and not occupancy.is_inside(registered_plate or plate_number):
+                logging.info("Parking lot is full")
+                return [
+                    (EVENT_PARK_FULL, bytearray([1])),
+                    (EVENT_DISPLAY, "Lot Full")
+                ]
+            
+            if registered_plate:
+                plate_number = registered_plate
                 logging.info(f"Plate {plate_number} is registered")
                 
-                # Increment lot capacity
-                with lock:
-                    lot_capacity += 1
-                    if lot_capacity >= MAX_CAPACITY:
-                        self.send_packet(EVENT_PARK_FULL, bytearray([1]))
+                # Take a space; another lane may have filled the last one meanwhile
+                admitted, now_full = occupancy.enter(plate_number)
+                if not admitted:
+                    logging.info("Parking lot is full")
+                    return [
+                        (EVENT_PARK_FULL, bytearray([1])),
+                        (EVENT_DISPLAY, "Lot Full")
+                    ]
+                if now_full:
+                    packets.append((EVENT_PARK_FULL, bytearray([1])))
+                    broadcast_packet(EVENT_PARK_FULL, bytes([1]), exclude=self)
                 
-                # Send commands to STM32
-                self.send_packet(EVENT_LP_STATUS, bytearray([1]))  # Registered
-                self.send_packet(EVENT_SERVO, bytearray([90]))     # Open barrier
-                self.send_packet(EVENT_DISPLAY, f"Welcome")
+                # Commands for STM32
+                if USE_ENTRY_DECISION_PACKET:
+                    # Registered + open barrier + message in one exchange
+                    packets.append((EVENT_ENTRY_DECISION, bytearray([1, 90]) + b"Welcome"))
+                else:
+                    packets.append((EVENT_LP_STATUS, bytearray([1])))  # Registered
+                    packets.append((EVENT_SERVO, bytearray([90])))     # Open barrier
+                    packets.append((EVENT_DISPLAY, f"Welcome"))
                 
                 # Log entry
                 log_vehicle_movement(plate_number, "entry")
             else:
                 logging.info(f"Plate {plate_number} is not registered")
-                self.send_packet(EVENT_LP_STATUS, bytearray([0]))  # Not registered
-                self.send_packet(EVENT_DISPLAY, "Invalid Plate")
+                if USE_ENTRY_DECISION_PACKET:
+                    packets.append((EVENT_ENTRY_DECISION, bytearray([0, 0]) + b"Invalid Plate"))
+                else:
+                    packets.append((EVENT_LP_STATUS, bytearray([0])))  # Not registered
+                    packets.append((EVENT_DISPLAY, "Invalid Plate"))
+            
+            # Only a refusal may be reused on a lookalike scene without reading the plate
+            self.result_cache.put(plate_number, region, packets, scene_match=not registered_plate)
+        elif occupancy.is_full():
+            logging.info("Parking lot is full")
+            packets.append((EVENT_PARK_FULL, bytearray([1])))
+            packets.append((EVENT_DISPLAY, "Lot Full"))
         else:
             logging.warning("Failed to detect license plate")
-            self.send_packet(EVENT_DISPLAY, "No Plate Found")
-    
-    @staticmethod
-    def calculate_crc8(data):
-        """Calculate CRC8 with polynomial 0x07"""
-        crc = 0
-        for byte in data:
-            crc ^= byte
-            for _ in range(8):
-                if crc & 0x80:
-                    crc = (crc << 1) ^ 0x07
-                else:
-                    crc = crc << 1
-                crc &= 0xFF  # Keep only 8 bits
-        return crc
+            packets.append((EVENT_DISPLAY, "No Plate Found"))
+        
+        return packets
+    
+    def decide_exit(self, frames):
+        """Decide whether a car at the exit barrier may leave
+        
+        Registered plates are let out even without a recorded entry (e.g.
+        a misread at the entry), so the lot never keeps a car in.
+        
+        Args:
+            frames (list): Burst of recent frames, newest first
+        
+        Returns:
+            list: (event_id, data) packets to send, in order
+        """
+        
+        packets = []
+        
+        plate_number, region = self.read_plate(frames)
+        if not plate_number:
+            logging.warning("Failed to detect license plate")
+            return [(EVENT_DISPLAY, "No Plate Found")]
+        
+        logging.info(f"Detected plate: {plate_number}")
+        registered_plate = find_registered_plate(plate_number)
+        
+        # Decided moments ago: do not log a second exit
+        cached = self.result_cache.get_plate(registered_plate or plate_number, region)
+        if cached is not None:
+            logging.info(f"Plate {cached[0]} decided moments ago, reusing decision")
+            return cached[1]
+        
+        if not registered_plate:
+            logging.info(f"Plate {plate_number} is not registered")
+            if USE_ENTRY_DECISION_PACKET:
+                packets.append((EVENT_ENTRY_DECISION, bytearray([0, 0]) + b"Invalid Plate"))
+            else:
+                packets.append((EVENT_LP_STATUS, bytearray([0])))
+                packets.append((EVENT_DISPLAY, "Invalid Plate"))
+            self.result_cache.put(plate_number, region, packets)
+            return packets
+        
+        plate_number = registered_plate
+        was_inside, space_freed = occupancy.exit(plate_number)
+        if not was_inside:
+            logging.warning(f"Plate {plate_number} is leaving without a recorded entry")
+        
+        if USE_ENTRY_DECISION_PACKET:
+            packets.append((EVENT_ENTRY_DECISION, bytearray([1, 90]) + b"Goodbye"))
+        else:
+            packets.append((EVENT_LP_STATUS, bytearray([1])))  # Registered
+            packets.append((EVENT_SERVO, bytearray([90])))     # Open barrier
+            packets.append((EVENT_DISPLAY, "Goodbye"))
+        if space_freed:
+            packets.append((EVENT_PARK_FULL, bytearray([0])))
+            broadcast_packet(EVENT_PARK_FULL, bytes([0]), exclude=self)
+        
+        log_vehicle_movement(plate_number, "exit")
+        self.result_cache.put(plate_number, region, packets, scene_match=False)
+        return packets
+    
+    # Table-driven CRC8 with polynomial 0x07
+    calculate_crc8 = staticmethod(crc8)
 
-def capture_license_plate():
-    """Capture and recognize license plate using dedicated detector and OCR
+class Lane:
+    """One barrier: its camera, its STM32 link and its direction"""
+    
+    def __init__(self, name, direction="entry", port="/dev/serial0", camera=CAMERA_INDEX, priority=None, baud_rate=115200):
+        """Create the lane (start() opens the camera and the UART)
+        
+        Args:
+            name (str): Lane name used in logs
+            direction (str): 'entry' or 'exit'
+            port (str): Serial device of the lane's STM32
+            camera (int or str): Camera device index or path
+            priority (int): Recognition priority, lower first
+            baud_rate (int): UART baud rate
+        """
+        self.name = name
+        self.camera = CameraCapture(
+            device=camera,
+            width=CAMERA_WIDTH,
+            height=CAMERA_HEIGHT,
+            buffer_size=CAMERA_BUFFER_SIZE
+        )
+        self.uart = UARTHandler(port, baud_rate, direction=direction, camera=self.camera, priority=priority, name=name)
+        self.motion = MotionDetector(self.camera, self.uart.on_motion, name=f"{name}-motion") if PRE_RECOGNITION else None
+    
+    def start(self):
+        """Start the camera, connect the STM32 and start the UART threads
+        
+        Returns:
+            bool: True if the lane is running
+        """
+        # Start camera capture so frames are ready before the first car
+        if not self.camera.start():
+            logging.error(f"Failed to start the camera of lane {self.name}")
+            return False
+        
+        if not self.uart.connect():
+            logging.error(f"Failed to connect the UART of lane {self.name}")
+            self.camera.stop()
+            return False
+        
+        for target in (self.uart.receiver_thread, self.uart.sender_thread):
+            thread = threading.Thread(target=target, name=f"{self.name}-{target.__name__}")
+            thread.daemon = True
+            thread.start()
+        
+        # Watch the camera for approaching cars
+        if self.motion is not None:
+            self.motion.start()
+        
+        # The STM32 may still show the state from before a restart
+        self.uart.send_packet(EVENT_PARK_FULL, bytes([1 if occupancy.is_full() else 0]))
+        
+        # Arrivals are answered with "System starting" until the models are ready
+        if not models.is_ready():
+            self.uart.send_packet(EVENT_DISPLAY, "System starting")
+        models.on_ready(lambda loaded: self.uart.send_packet(EVENT_DISPLAY, "System Ready"))
+        
+        logging.info(f"Lane {self.name} running ({self.uart.direction}, {self.uart.port}, priority {self.uart.priority})")
+        return True
+    
+    def stop(self):
+        """Disconnect the UART and stop the camera"""
+        if self.motion is not None:
+            self.motion.stop()
+        self.uart.disconnect()
+        self.camera.stop()
+
+def capture_license_plate(frames, camera=None):
+    """Recognize the license plate in a burst of recent frames
+    
+    Frames are run through detection and OCR until the per-character
+    vote reaches consensus, so a clear first frame is enough.
+    
+    Args:
+        frames (list): Frames from camera.burst(), newest first
+        camera (str): Lane whose adaptive ROI history the detector uses
     
     Returns:
-        str or None: Recognized plate number or None if failed
+        tuple: (plate number, [x1, y1, x2, y2] plate box), or (None, None) if failed
     """
     try:
-        # Open camera (adjust index if needed)
-        cap = cv2.VideoCapture(0)
-        if not cap.isOpened():
-            logging.error("Failed to open webcam")
-            return None
-        
-        # Set camera parameters
-        cap.set(cv2.CAP_PROP_FRAME_WIDTH, 1280)
-        cap.set(cv2.CAP_PROP_FRAME_HEIGHT, 720)
-        
-        # Allow camera to adjust exposure
-        for _ in range(5):
-            cap.read()
-            time.sleep(0.1)
-        
-        # Capture frame
-        ret, frame = cap.read()
-        if not ret:
-            logging.error("Failed to capture frame")
-            cap.release()
-            return None
-        
-        # Save original image for debugging
-        timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
-        debug_dir = "debug_images"
-        os.makedirs(debug_dir, exist_ok=True)
-        cv2.imwrite(f"{debug_dir}/original_{timestamp}.jpg", frame)
-        
-        # Use license plate detector to find and crop the license plate
-        cropped_plate = detector.detect_and_crop(frame)
-        
-        if cropped_plate is not None:
-            # Save detected plate image
-            cv2.imwrite(f"{debug_dir}/plate_{timestamp}.jpg", cropped_plate)
-            
-            # Use OCR to read the plate text
-            plate_text = ocr.read_text(cropped_plate)
-            
-            # Release camera
-            cap.release()
-            
-            if plate_text:
-                # Clean up the detected text (remove spaces, convert to uppercase)
-                plate_text = plate_text.upper().replace(' ', '')
-                logging.info(f"Detected license plate text: {plate_text}")
-                return plate_text
-            else:
-                logging.warning("OCR could not read text from the detected plate")
-                return None
+        if not frames:
+            return None, None
+        
+        # Detect and read the plate across the burst
+        with STAGE_SECONDS.time(stage="recognition"):
+            result = recognizer.recognize(frames, camera=camera)
+        if ocr is not None:
+            ocr_stats = ocr.get_stats()
+            logging.info(f"OCR fallback pass used in {ocr_stats['fallbacks']}/{ocr_stats['reads']} reads, "
+                         f"rec-only fell back in {ocr_stats['rec_only_fallbacks']}/{ocr_stats['rec_only_reads']}")
+        
+        # Hand sampled arrivals to the background debug writer
+        if debug_sink.sample(failed=result is None):
+            debug_sink.submit("original", frames[0])
+            if result is not None:
+                debug_sink.submit("plate", result["crop"])
+        
+        if result is not None:
+            plate_text = result["plate"]
+            logging.info(f"Detected license plate text: {plate_text} "
+                         f"(score {result['score']:.2f} over {result['frames_used']} frame(s))")
+            return plate_text, result["box"]
         else:
-            logging.warning("No license plate detected in image")
-            # Save processed image
-            cv2.imwrite(f"{debug_dir}/processed_{timestamp}.jpg", frame)
-            cap.release()
-            return None
+            logging.warning("No license plate read from burst")
+            return None, None
             
     except Exception as e:
         logging.error(f"Error capturing license plate: {str(e)}")
-        return None
+        return None, None
 
 def init_database():
     """Initialize SQLite database if it doesn't exist"""
     try:
-        conn = sqlite3.connect(db_path)
-        cursor = conn.cursor()
-        
-        # Create plates table if it doesn't exist
-        cursor.execute('''
-        CREATE TABLE IF NOT EXISTS plates (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            plate_number TEXT UNIQUE NOT NULL,
-            added_date TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        )
-        ''')
-        
-        # Create log table for entries/exits
-        cursor.execute('''
-        CREATE TABLE IF NOT EXISTS movement_log (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            plate_number TEXT NOT NULL,
-            action TEXT NOT NULL,  -- 'entry' or 'exit'
-            timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        )
-        ''')
-        
-        conn.commit()
-        conn.close()
+        db.init_schema()
         logging.info("Database initialized successfully")
         return True
     except Exception as e:
         logging.error(f"Error initializing database: {str(e)}")
         return False
 
-def check_plate_registered(plate_number):
-    """Check if a license plate is registered in the database
+def find_registered_plate(plate_number):
+    """Find the registered plate matching an OCR reading, tolerating OCR confusions
     
     Args:
-        plate_number (str): License plate number to check
+        plate_number (str): License plate number read by OCR
     
     Returns:
-        bool: True if plate is registered, False otherwise
+        str or None: Registered plate number, or None if no plate is close enough
     """
-    try:
-        conn = sqlite3.connect(db_path)
-        cursor = conn.cursor()
-        
-        cursor.execute("SELECT 1 FROM plates WHERE plate_number = ?", (plate_number,))
-        result = cursor.fetchone()
-        
-        conn.close()
-        return result is not None
-    except Exception as e:
-        logging.error(f"Error checking plate registration: {str(e)}")
-        return False
+    registered, score = plate_index.match(plate_number)
+    if registered is not None and registered != plate_number:
+        logging.info(f"Fuzzy matched {plate_number} to registered plate {registered} (score {score:.2f})")
+    return registered
 
 def log_vehicle_movement(plate_number, action):
     """Log vehicle entry or exit
     
+    The event is spooled and written by the background log writer, so
+    this never waits on a database commit.
+    
     Args:
         plate_number (str): License plate number
         action (str): 'entry' or 'exit'
     """
     try:
-        conn = sqlite3.connect(db_path)
-        cursor = conn.cursor()
-        
-        cursor.execute(
-            "INSERT INTO movement_log (plate_number, action) VALUES (?, ?)",
-            (plate_number, action)
-        )
-        
-        conn.commit()
-        conn.close()
+        if not log_writer.log(plate_number, action):
+            return False
         logging.info(f"Logged {action} for plate {plate_number}")
         return True
     except Exception as e:
@@ -428,31 +1014,86 @@ def log_vehicle_movement(plate_number, action):
 def main():
     """Main function"""
     
+    # Load the detector and OCR models in the background while everything else starts
+    models.start()
+    
+    # Stage latencies and error counters for Prometheus
+    if METRICS_PORT:
+        try:
+            metrics_server.start()
+        except OSError as e:
+            logging.error(f"Failed to start metrics endpoint on port {METRICS_PORT}: {str(e)}")
+    
     # Initialize database
     if not init_database():
         logging.error("Failed to initialize database. Exiting.")
         return
     
-    # Connect to UART
-    uart = UARTHandler()
-    if not uart.connect():
-        logging.error("Failed to connect to UART. Exiting.")
+    # Replay unwritten movement events and start the background log writer
+    try:
+        log_writer.start()
+    except Exception as e:
+        logging.error(f"Failed to start movement log writer: {str(e)}. Exiting.")
         return
     
-    # Start receiver thread
-    receiver_thread = threading.Thread(target=uart.receiver_thread)
-    receiver_thread.daemon = True
-    receiver_thread.start()
+    # Background writer for debug images
+    debug_sink.start()
+    
+    # Move old movement_log rows into the monthly archives once a day
+    log_archive.start()
+    
+    # Plates inside the lot, as left by every movement written so far, then follow other gates
+    try:
+        occupancy.start()
+    except Exception as e:
+        logging.error(f"Failed to load lot occupancy: {str(e)}. Exiting.")
+        return
+    
+    # Load registered plates into memory and follow changes from the web app
+    try:
+        plate_index.start()
+    except Exception as e:
+        logging.error(f"Failed to load registered plates: {str(e)}. Exiting.")
+        return
+    
+    # Start recognition workers before any arrival can be queued
+    recognition_pool.start()
+    
+    # Start every lane; one that fails is left out rather than stopping the others
+    for config in LANES:
+        try:
+            lane = Lane(**config)
+        except Exception as e:
+            logging.error(f"Skipping lane {config.get('name', '?')}: invalid configuration ({str(e)})")
+            continue
+        if lane.start():
+            lanes.append(lane)
+    if not lanes:
+        logging.error("No lane could be started. Exiting.")
+        recognition_pool.stop()
+        return
     
-    logging.info("Smart Car Park system running")
+    logging.info(f"Smart Car Park system running with {len(lanes)} lane(s)")
     
     try:
         while True:
             time.sleep(1)
+            if models.failed:
+                logging.error(f"Failed to load recognition models ({models.error}). Exiting.")
+                break
     except KeyboardInterrupt:
         logging.info("Shutting down...")
     finally:
-        uart.disconnect()
+        for lane in lanes:
+            lane.stop()
+        recognition_pool.stop()
+        plate_index.stop()
+        occupancy.stop()
+        log_writer.stop()
+        log_archive.stop()
+        debug_sink.stop()
+        metrics_server.stop()
+        db.close()
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
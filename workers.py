@@ -0,0 +1,94 @@
+import itertools
+import logging
+import queue
+import threading
+
+logger = logging.getLogger(__name__)
+
+
+class RecognitionPool:
+    """
+    Bounded job queue served by a dedicated pool of worker threads
+
+    Keeps slow recognition work (camera, detection, OCR, database) off
+    the UART receiver thread. Each job is a callable; its result is handed
+    to the job's callback, which typically puts it on a response queue.
+
+    The pool can be shared by several lanes: jobs with a lower priority
+    value run first, and jobs of equal priority run in submission order.
+    """
+
+    def __init__(self, workers=1, max_pending=4, name="recognition"):
+        """
+        Initialize the pool (threads are started by start())
+
+        Args:
+            workers: Number of worker threads
+            max_pending: Maximum number of queued jobs before submit() refuses
+            name: Thread name prefix
+        """
+        self.workers = workers
+        self.name = name
+        self.jobs = queue.PriorityQueue(maxsize=max_pending)
+        self._sequence = itertools.count()
+        self.running = False
+        self._threads = []
+
+    def start(self):
+        """Start the worker threads"""
+        if self.running:
+            return
+        self.running = True
+        for i in range(self.workers):
+            thread = threading.Thread(target=self._worker, name=f"{self.name}-{i}")
+            thread.daemon = True
+            thread.start()
+            self._threads.append(thread)
+        logger.info(f"Started {self.workers} {self.name} worker(s)")
+
+    def stop(self):
+        """Stop the worker threads after their current job"""
+        self.running = False
+        for thread in self._threads:
+            thread.join(timeout=5)
+        self._threads = []
+
+    def pending(self):
+        """Number of jobs waiting for a worker"""
+        return self.jobs.qsize()
+
+    def submit(self, func, callback=None, priority=0):
+        """
+        Queue a job without blocking
+
+        Args:
+            func: Callable run on a worker thread
+            callback: Optional callable receiving func's return value
+            priority: Lower values run first
+
+        Returns:
+            bool: True if queued, False if the queue is full
+        """
+        try:
+            self.jobs.put_nowait((priority, next(self._sequence), func, callback))
+            return True
+        except queue.Full:
+            logger.warning(f"{self.name} queue full, dropping job")
+            return False
+
+    def _worker(self):
+        """Worker loop: run jobs and pass results to their callbacks"""
+        while self.running:
+            try:
+                _, _, func, callback = self.jobs.get(timeout=0.5)
+            except queue.Empty:
+                continue
+
+            try:
+                result = func()
+                if callback is not None:
+                    callback(result)
+            except Exception as e:
+                logger.error(f"Error in {self.name} job: {str(e)}")
+            finally:
+                self.jobs.task_done()